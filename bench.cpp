@@ -0,0 +1,540 @@
+// Micro-benchmarks for the ps5_kontroller hot paths.
+//
+// Usage: bench [name ...]   (runs every benchmark when no name is given)
+
+#include <arpa/inet.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <vector>
+#include "crc32.h"
+#include "dualsense.h"
+#include "dualsense_layout.h"
+#include "filter_chain.h"
+#include "gesture_detector.h"
+#include "imu_batch.h"
+#include "input_state.h"
+#include "orientation_fusion.h"
+#include "osc_encoder.h"
+#include "osc_fanout.h"
+#include "udp_transport.h"
+
+// Count every heap allocation made through operator new. The replacements are
+// kept out of line: inlined, GCC pairs their malloc with a delete expression
+// and warns about a mismatched deallocation (-Wmismatched-new-delete).
+static std::atomic<unsigned long long> allocationCount{0};
+
+__attribute__((noinline)) void* operator new(size_t size) {
+    allocationCount++;
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* name, unsigned long long iterations, double seconds, unsigned long long allocations) {
+    printf("%-28s %10.1f ns/op %12.0f op/s %8.3f allocs/op\n",
+           name, seconds * 1e9 / iterations, iterations / seconds, (double)allocations / iterations);
+}
+
+// Reproducible noise in [-0.5, 0.5) for synthetic sensor streams
+static float benchNoise(unsigned& seed) {
+    seed = seed * 1103515245u + 12345u;
+    return ((seed >> 16) & 0x7FFF) / 32768.0f - 0.5f;
+}
+
+// UDP socket on an ephemeral loopback port that swallows the benchmark's datagrams
+static int openSink(char* port, size_t portSize) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    bind(fd, (sockaddr*)&addr, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr*)&addr, &len);
+    snprintf(port, portSize, "%u", ntohs(addr.sin_port));
+    return fd;
+}
+
+// Encode one /ps5/imu sample per iteration, sent per sample or batched, to one or more destinations
+static void benchOsc() {
+    const unsigned long long SAMPLES = 1000000;
+    const unsigned long long WARMUP = 10000;
+
+    const int MAX_SINKS = 3;
+    char ports[MAX_SINKS][16];
+    int sinks[MAX_SINKS];
+    for (int i = 0; i < MAX_SINKS; ++i) {
+        sinks[i] = openSink(ports[i], sizeof(ports[i]));
+    }
+
+    OscMessageTemplate imu("/ps5/imu", "iffffffd");
+    struct Config {
+        uint64_t windowUs;
+        int destinations;
+    };
+    const Config configs[] = {{0, 1}, {4000, 1}, {4000, 3}};
+    for (const Config& config : configs) {
+        UdpTransport transport;
+        OscFanout output(transport, config.windowUs, 1400);
+        for (int i = 0; i < config.destinations; ++i) {
+            OscDestinationConfig dest;
+            char spec[64];
+            snprintf(spec, sizeof(spec), "127.0.0.1:%s", ports[i]);
+            parseOscDestination(spec, &dest);
+            output.addDestination(dest);
+        }
+        uint64_t nowUs = 0;
+        OscTimetag tag = {3900000000u, 0};
+
+        unsigned long long allocationsBefore = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned long long i = 0; i < WARMUP + SAMPLES; ++i) {
+            if (i == WARMUP) {
+                allocationsBefore = allocationCount.load();
+                start = std::chrono::steady_clock::now();
+            }
+            float v = (float)(i & 1023) * 0.001f;
+            imu.setInt(0, 0);
+            for (int a = 0; a < 6; ++a) {
+                imu.setFloat(1 + a, v + a);
+            }
+            imu.setDouble(7, i * 4.0);
+            tag.frac += 4294967; // 1 kHz sample rate
+            nowUs += 1000;
+            output.add(imu, tag, 2, nowUs);
+            output.flushIfDue(nowUs);
+            transport.flush();
+        }
+        output.flush();
+        transport.flush();
+
+        char name[64];
+        snprintf(name, sizeof(name), "osc imu window=%llums dests=%d",
+                 (unsigned long long)(config.windowUs / 1000), config.destinations);
+        report(name, SAMPLES, secondsSince(start), allocationCount.load() - allocationsBefore);
+    }
+    for (int i = 0; i < MAX_SINKS; ++i) {
+        close(sinks[i]);
+    }
+}
+
+// Send small datagrams through UdpTransport, flushing after every N of them
+static void benchUdp() {
+    const unsigned long long DATAGRAMS = 500000;
+
+    char port[16];
+    int sink = openSink(port, sizeof(port));
+    uint8_t datagram[64] = {0};
+
+    const int batchSizes[] = {1, 8, 32};
+    for (int batch : batchSizes) {
+        UdpTransport transport;
+        transport.addDestination("127.0.0.1", port);
+
+        unsigned long long allocationsBefore = allocationCount.load();
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned long long i = 0; i < DATAGRAMS; ++i) {
+            transport.queue(datagram, sizeof(datagram), 1);
+            if ((int)(i % batch) == batch - 1) {
+                transport.flush();
+            }
+        }
+        transport.flush();
+
+        char name[64];
+        snprintf(name, sizeof(name), "udp datagram batch=%d", batch);
+        report(name, DATAGRAMS, secondsSince(start), allocationCount.load() - allocationsBefore);
+    }
+    close(sink);
+}
+
+// Validate the CRC of one 78-byte Bluetooth input report per iteration
+static void benchCrc() {
+    const unsigned long long REPORTS = 10000000;
+
+    uint8_t data[DS_INPUT_REPORT_BT_SIZE];
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = (uint8_t)(i * 37 + 11);
+    }
+    data[0] = DS_INPUT_REPORT_BT;
+
+    volatile uint32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long long i = 0; i < REPORTS; ++i) {
+        data[2] = (uint8_t)i;
+        sink = sink + crc32UpdateBytewise(CRC32_INIT, data, DS_INPUT_REPORT_BT_CRC_OFFSET + 1);
+    }
+    report("crc32 bytewise 75 bytes", REPORTS, secondsSince(start), 0);
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned long long i = 0; i < REPORTS; ++i) {
+        data[2] = (uint8_t)i;
+        sink = sink + dsBluetoothCrcValid(data);
+    }
+    report("crc32 slicing-by-8 bt report", REPORTS, secondsSince(start), 0);
+}
+
+// Hand-written IMU extraction at fixed USB offsets, as test.cpp used to do it.
+// memcpy instead of the old int16_t* casts keeps it defined; the code is the same.
+static inline int16_t loadInt16(const uint8_t* p) {
+    int16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t loadUint32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Sum the IMU fields of the same reports with an extractor, one report per iteration
+template <typename Extract>
+static void benchExtract(const char* name, const uint8_t (*reports)[DS_INPUT_REPORT_USB_SIZE], int reportCount,
+                         Extract extract) {
+    const unsigned long long REPORTS = 20000000;
+
+    volatile float sink = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long long i = 0; i < REPORTS; ++i) {
+        sink = sink + extract(reports[i % reportCount]);
+    }
+    report(name, REPORTS, secondsSince(start), 0);
+}
+
+// Extract gyro, accel and timestamp from USB reports by hand and through the layout table
+static void benchLayout() {
+    const int REPORT_COUNT = 64;
+
+    static uint8_t reports[REPORT_COUNT][DS_INPUT_REPORT_USB_SIZE];
+    for (int r = 0; r < REPORT_COUNT; ++r) {
+        for (int i = 0; i < DS_INPUT_REPORT_USB_SIZE; ++i) {
+            reports[r][i] = (uint8_t)(r * 131 + i * 37 + 11);
+        }
+        reports[r][0] = DS_INPUT_REPORT_USB;
+    }
+
+    benchExtract("imu fields hand-written", reports, REPORT_COUNT, [](const uint8_t* data) {
+        return loadInt16(&data[16]) * DS_GYRO_SCALE + loadInt16(&data[18]) * DS_GYRO_SCALE +
+               loadInt16(&data[20]) * DS_GYRO_SCALE + loadInt16(&data[22]) * DS_ACCEL_SCALE +
+               loadInt16(&data[24]) * DS_ACCEL_SCALE + loadInt16(&data[26]) * DS_ACCEL_SCALE +
+               (float)loadUint32(&data[28]);
+    });
+    benchExtract("imu fields layout table", reports, REPORT_COUNT, [](const uint8_t* data) {
+        const DsReportLayout& L = DS_LAYOUT_USB;
+        return dsFieldScaled<L, DS_FIELD_GYRO_X>(data) + dsFieldScaled<L, DS_FIELD_GYRO_Y>(data) +
+               dsFieldScaled<L, DS_FIELD_GYRO_Z>(data) + dsFieldScaled<L, DS_FIELD_ACCEL_X>(data) +
+               dsFieldScaled<L, DS_FIELD_ACCEL_Y>(data) + dsFieldScaled<L, DS_FIELD_ACCEL_Z>(data) +
+               (float)dsFieldRaw<L, DS_FIELD_SENSOR_TIMESTAMP>(data);
+    });
+}
+
+// Convert a block of recorded USB reports to struct-of-arrays floats with every supported kernel
+static void benchImuBatch() {
+    const size_t REPORT_COUNT = 4096;
+    const int PASSES = 2000;
+
+    std::vector<uint8_t> reports(REPORT_COUNT * DS_INPUT_REPORT_USB_SIZE);
+    for (size_t i = 0; i < reports.size(); ++i) {
+        reports[i] = (uint8_t)(i * 2654435761u >> 13);
+    }
+    ImuAxisScale scale = imuNominalScale(DS_LAYOUT_USB);
+
+    std::vector<float> expected(REPORT_COUNT * IMU_AXES);
+    std::vector<float> actual(REPORT_COUNT * IMU_AXES);
+    ImuBatchOutput expectedOut;
+    ImuBatchOutput actualOut;
+    for (int a = 0; a < IMU_AXES; ++a) {
+        expectedOut.axis[a] = &expected[a * REPORT_COUNT];
+        actualOut.axis[a] = &actual[a * REPORT_COUNT];
+    }
+    imuBatchDecode(DS_LAYOUT_USB, reports.data(), DS_INPUT_REPORT_USB_SIZE, REPORT_COUNT, scale, expectedOut,
+                   IMU_KERNEL_SCALAR);
+
+    for (int k = 0; k < IMU_KERNEL_COUNT; ++k) {
+        ImuBatchKernel kernel = (ImuBatchKernel)k;
+        if (!imuBatchKernelSupported(kernel)) {
+            printf("imu batch %-18s not supported on this CPU\n", imuBatchKernelName(kernel));
+            continue;
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < PASSES; ++pass) {
+            imuBatchDecode(DS_LAYOUT_USB, reports.data(), DS_INPUT_REPORT_USB_SIZE, REPORT_COUNT, scale, actualOut,
+                           kernel);
+        }
+        double seconds = secondsSince(start);
+        float maxError = 0.0f;
+        for (size_t i = 0; i < expected.size(); ++i) {
+            float error = fabsf(expected[i] - actual[i]);
+            maxError = error > maxError ? error : maxError;
+        }
+
+        char name[64];
+        snprintf(name, sizeof(name), "imu batch %s%s", imuBatchKernelName(kernel),
+                 kernel == imuBatchBestKernel() ? " (auto)" : "");
+        report(name, (unsigned long long)REPORT_COUNT * PASSES, seconds, 0);
+        if (maxError > 1e-4f) {
+            printf("imu batch %s differs from the scalar kernel by %g\n", imuBatchKernelName(kernel), maxError);
+        }
+    }
+}
+
+// Decode the full input state of a USB report, diff it against the previous
+// one and turn the changes into samples. Sensors change every report; a
+// button, stick or touch changes in one report of 16, as when a player holds
+// the controller still.
+static void benchState() {
+    const int REPORT_COUNT = 64;
+    const unsigned long long REPORTS = 20000000;
+
+    static uint8_t reports[REPORT_COUNT][DS_INPUT_REPORT_USB_SIZE];
+    for (int r = 0; r < REPORT_COUNT; ++r) {
+        memset(reports[r], 0, sizeof(reports[r]));
+        reports[r][0] = DS_INPUT_REPORT_USB;
+        for (int i = 1; i <= 4; ++i) {
+            reports[r][i] = 128;
+        }
+        reports[r][8] = 0x08; // d-pad released
+        reports[r][33] = reports[r][37] = 0x80; // no touch
+        for (int i = 16; i < 32; ++i) {
+            reports[r][i] = (uint8_t)(r * 131 + i * 37 + 11);
+        }
+        if (r % 16 == 5) {
+            reports[r][8] |= 0x20; // cross
+            reports[r][1] = 200;
+        }
+    }
+
+    DsInputState states[2] = {};
+    Sample samples[DS_MAX_DELTA_SAMPLES];
+    unsigned long long emitted = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long long i = 0; i < REPORTS; ++i) {
+        const DsInputState& previous = states[i & 1];
+        DsInputState& state = states[(i + 1) & 1];
+        dsDecodeState<DS_LAYOUT_USB>(reports[i % REPORT_COUNT], previous, &state);
+        DsStateDelta delta = dsDiffState(previous, state);
+        if (delta.buttons | delta.axes | (delta.fields >> DS_STATE_TOUCH_0)) {
+            emitted += dsDeltaSamples(state, delta, 0, i, samples);
+        }
+    }
+    report("input state decode and diff", REPORTS, secondsSince(start), 0);
+    printf("input state: %.3f samples per report\n", (double)emitted / REPORTS);
+}
+
+// One orientation filter update per sample: a controller turning slowly
+// while the accelerometer sees gravity plus hand jitter, at 250 Hz
+static void benchFusion() {
+    const int SAMPLE_COUNT = 1024;
+    const unsigned long long UPDATES = 20000000;
+
+    static float gyro[SAMPLE_COUNT][3];
+    static float accel[SAMPLE_COUNT][3];
+    unsigned seed = 12345;
+    for (int i = 0; i < SAMPLE_COUNT; ++i) {
+        gyro[i][0] = 0.3f * sinf(i * 0.01f) + 0.02f * benchNoise(seed);
+        gyro[i][1] = 0.5f + 0.02f * benchNoise(seed);
+        gyro[i][2] = 0.02f * benchNoise(seed);
+        accel[i][0] = 0.5f * benchNoise(seed);
+        accel[i][1] = 9.80665f + 0.5f * benchNoise(seed);
+        accel[i][2] = 0.5f * benchNoise(seed);
+    }
+
+    const FusionAlgorithm algorithms[] = {FUSION_MADGWICK, FUSION_MAHONY};
+    const char* names[] = {"fusion madgwick update", "fusion mahony update"};
+    for (int a = 0; a < 2; ++a) {
+        OrientationFilter filter(algorithms[a]);
+        unsigned long long allocationsBefore = allocationCount.load();
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned long long i = 0; i < UPDATES; ++i) {
+            int s = (int)(i % SAMPLE_COUNT);
+            filter.update(gyro[s], accel[s], 0.004f);
+        }
+        report(names[a], UPDATES, secondsSince(start), allocationCount.load() - allocationsBefore);
+        const Quaternion& q = filter.orientation();
+        printf("fusion: final |q| %.6f\n", sqrtf(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z));
+    }
+}
+
+// One filter bank pass per sample: all six sensor channels and the six held
+// axes of a controller per IMU sample at 250 Hz, with a low-pass on the
+// sensors and a deadzone and one-euro filter on the sticks, and a stick move
+// held for the next IMU sample after every third of them
+static void benchFilter() {
+    const int SAMPLE_COUNT = 1024;
+    const unsigned long long UPDATES = 20000000;
+
+    static Sample samples[SAMPLE_COUNT];
+    unsigned seed = 12345;
+    // Every fourth sample moves one of the sticks, so the held-axis path runs too
+    uint64_t timeUs = 0;
+    for (int i = 0; i < SAMPLE_COUNT; ++i) {
+        Sample& sample = samples[i];
+        sample.controller = 0;
+        if (i % 4 == 3) {
+            sample.kind = SAMPLE_AXIS;
+            sample.code = (i / 4) % 4;
+            sample.value = (int32_t)(20000.0f * sinf(i * 0.02f) + 500.0f * benchNoise(seed));
+            sample.hostTimeUs = timeUs;
+            continue;
+        }
+        timeUs += 4000;
+        sample.kind = SAMPLE_IMU;
+        sample.timestampUs = timeUs;
+        sample.hostTimeUs = timeUs;
+        for (int k = 0; k < 6; ++k) {
+            sample.data[k] = (k == 4 ? 9.80665f : 0.3f * sinf(i * 0.01f)) + 0.05f * benchNoise(seed);
+        }
+    }
+
+    const char* specs[] = {"imu:lowpass:20", "sticks:deadzone:0.08", "sticks:one_euro:1:0.007"};
+    FilterConfig config;
+    for (const char* spec : specs) {
+        FilterSpec filter;
+        parseFilterSpec(spec, &filter);
+        config.add(filter);
+    }
+    config.prepare(250.0);
+    FilterBank bank(config, 250.0);
+
+    Sample axes[FilterConfig::AXIS_LANES];
+    int axisCount = 0;
+    unsigned long long sent = 0;
+    unsigned long long held = 0;
+    float sum = 0.0f;
+    unsigned long long allocationsBefore = allocationCount.load();
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long long i = 0; i < UPDATES; ++i) {
+        Sample sample = samples[i % SAMPLE_COUNT];
+        held += bank.process(sample, axes, &axisCount) ? 0 : 1;
+        sent += axisCount;
+        sum += sample.data[0];
+    }
+    report("filter bank pass (12 channels)", UPDATES, secondsSince(start), allocationCount.load() - allocationsBefore);
+    printf("filter: %llu stick samples held, %llu axis samples sent, checksum %.3f\n", held, sent, sum);
+    if (held == 0 || sent == 0) {
+        printf("filter: the held-axis path was not exercised\n");
+    }
+}
+
+// One gesture detector step per IMU sample at 250 Hz: a controller held
+// still, tapped, shaken, flicked and twisted in turn, so every detector state
+// is hit
+static void benchGesture() {
+    const int SAMPLE_COUNT = 1000; // 4 s
+    const unsigned long long UPDATES = 20000000;
+
+    static Sample samples[SAMPLE_COUNT];
+    unsigned seed = 12345;
+    for (int i = 0; i < SAMPLE_COUNT; ++i) {
+        Sample& sample = samples[i];
+        float t = i / 250.0f;
+        sample.kind = SAMPLE_IMU;
+        sample.controller = 0;
+        for (int k = 0; k < 6; ++k) {
+            sample.data[k] = (k == 4 ? 9.80665f : 0.0f) + (k < 3 ? 0.01f : 0.05f) * benchNoise(seed);
+        }
+        if (t >= 0.8f && t < 0.82f) {
+            sample.data[3] += 2.5f * 9.80665f; // tap
+        } else if (t >= 1.0f && t < 2.0f) {
+            sample.data[3] += 25.0f * sinf(t * 2.0f * (float)M_PI * 5.0f); // shake
+        } else if (t >= 2.5f && t < 2.65f) {
+            sample.data[0] += 8.0f * sinf((t - 2.5f) / 0.15f * (float)M_PI); // flick
+        } else if (t >= 3.2f && t < 3.5f) {
+            sample.data[2] += 5.0f; // twist
+        }
+    }
+
+    GestureDetector detector;
+    Gesture gestures[GESTURE_KINDS];
+    unsigned long long detected[GESTURE_KINDS] = {};
+    unsigned long long allocationsBefore = allocationCount.load();
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long long i = 0; i < UPDATES; ++i) {
+        Sample& sample = samples[i % SAMPLE_COUNT];
+        sample.timestampUs = 4000 * (i + 1);
+        sample.hostTimeUs = sample.timestampUs;
+        int count = detector.add(sample, gestures);
+        for (int g = 0; g < count; ++g) {
+            detected[gestures[g].kind]++;
+        }
+    }
+    report("gesture detector step", UPDATES, secondsSince(start), allocationCount.load() - allocationsBefore);
+    const char* names[GESTURE_KINDS] = {"shake", "tap", "flick", "twist"};
+    double passes = (double)UPDATES / SAMPLE_COUNT;
+    printf("gesture: per 4 s pass");
+    for (int k = 0; k < GESTURE_KINDS; ++k) {
+        printf(" %s %.2f", names[k], detected[k] / passes);
+    }
+    printf("\n");
+    for (int k = 0; k < GESTURE_KINDS; ++k) {
+        if (detected[k] == 0) {
+            printf("gesture: the %s detector never fired\n", names[k]);
+        }
+    }
+}
+
+struct Benchmark {
+    const char* name;
+    void (*run)();
+};
+
+static const Benchmark BENCHMARKS[] = {
+    {"crc", benchCrc},
+    {"filter", benchFilter},
+    {"fusion", benchFusion},
+    {"gesture", benchGesture},
+    {"imu", benchImuBatch},
+    {"layout", benchLayout},
+    {"osc", benchOsc},
+    {"state", benchState},
+    {"udp", benchUdp},
+};
+
+int main(int argc, char* argv[]) {
+    for (const Benchmark& bench : BENCHMARKS) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i) {
+            selected = selected || strcmp(argv[i], bench.name) == 0;
+        }
+        if (selected) {
+            bench.run();
+        }
+    }
+    return 0;
+}
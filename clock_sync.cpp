@@ -0,0 +1,96 @@
+#include "clock_sync.h"
+
+#include <algorithm>
+#include <math.h>
+
+// Crystal oscillators stay well inside this; a larger slope is a bad fit
+static const double MAX_SKEW = 1000e-6;
+
+static double median(double* values, int count) {
+    std::nth_element(values, values + count / 2, values + count);
+    return values[count / 2];
+}
+
+void DeviceClockSync::reset() {
+    synced_ = false;
+    windowOpen_ = false;
+    pointCount_ = 0;
+    nextPoint_ = 0;
+    intercept_ = 0.0;
+    slope_ = 0.0;
+    lastMappedUs_ = 0;
+}
+
+uint64_t DeviceClockSync::map(uint64_t deviceUs, uint64_t arrivalUs) {
+    if (deviceUs == 0) {
+        return arrivalUs; // hardware provides no timestamp
+    }
+
+    double observed = (double)((int64_t)arrivalUs - (int64_t)deviceUs);
+    if (!synced_) {
+        reset();
+        originUs_ = deviceUs;
+        intercept_ = observed;
+        synced_ = true;
+    }
+    double device = (double)(int64_t)(deviceUs - originUs_);
+
+    if (!windowOpen_) {
+        windowOpen_ = true;
+        windowEndUs_ = deviceUs + WINDOW_US;
+        windowMin_ = {device, observed};
+    } else if (observed < windowMin_.offsetUs) {
+        windowMin_ = {device, observed};
+    }
+    if (deviceUs >= windowEndUs_) {
+        closeWindow();
+    }
+
+    // An arrival earlier than predicted proves the line too high
+    double offset = predict(device);
+    if (observed < offset) {
+        intercept_ -= offset - observed;
+        offset = observed;
+    }
+
+    uint64_t mapped = (uint64_t)((int64_t)deviceUs + (int64_t)llround(offset));
+    if (mapped < lastMappedUs_) {
+        mapped = lastMappedUs_;
+    }
+    lastMappedUs_ = mapped;
+    return mapped;
+}
+
+void DeviceClockSync::closeWindow() {
+    windowOpen_ = false;
+    points_[nextPoint_] = windowMin_;
+    nextPoint_ = (nextPoint_ + 1) % MAX_POINTS;
+    pointCount_ = pointCount_ < MAX_POINTS ? pointCount_ + 1 : MAX_POINTS;
+    fit();
+}
+
+void DeviceClockSync::fit() {
+    int n = pointCount_;
+    int first = (nextPoint_ - n + MAX_POINTS) % MAX_POINTS;
+    auto point = [&](int k) -> const Point& { return points_[(first + k) % MAX_POINTS]; };
+
+    if (n >= 2) {
+        int half = n / 2;
+        int slopes = 0;
+        for (int i = 0; i + half < n; ++i) {
+            double dx = point(i + half).deviceUs - point(i).deviceUs;
+            if (dx > 0) {
+                scratch_[slopes++] = (point(i + half).offsetUs - point(i).offsetUs) / dx;
+            }
+        }
+        if (slopes > 0) {
+            double slope = median(scratch_, slopes);
+            slope_ = slope > MAX_SKEW ? MAX_SKEW : (slope < -MAX_SKEW ? -MAX_SKEW : slope);
+        }
+    }
+
+    for (int k = 0; k < n; ++k) {
+        scratch_[k] = point(k).offsetUs - slope_ * point(k).deviceUs;
+    }
+    intercept_ = median(scratch_, n);
+}
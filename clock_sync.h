@@ -0,0 +1,86 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <stdint.h>
+
+// Extends a wrapping 32-bit device counter to 64 bits. Works as long as
+// consecutive values are less than one wrap apart.
+class TickUnwrapper {
+public:
+    uint64_t unwrap(uint32_t tick) {
+        ticks_ += started_ ? (uint32_t)(tick - last_) : tick;
+        last_ = tick;
+        started_ = true;
+        return ticks_;
+    }
+
+    void reset() {
+        started_ = false;
+        ticks_ = 0;
+    }
+
+private:
+    bool started_ = false;
+    uint32_t last_ = 0;
+    uint64_t ticks_ = 0;
+};
+
+// Maps controller sensor timestamps onto the host monotonic clock
+// (hostMonotonicUs, CLOCK_MONOTONIC on Linux), following both the offset and
+// the rate difference (skew) of the two clocks.
+//
+// arrival = device * (1 + skew) + offset + transport delay, and the delay is
+// never negative, so the lower envelope of (arrival - device) over device time
+// is the clock relation. Every WINDOW_US the smallest (arrival - device) of the
+// window is kept as a point; a line through the last MAX_POINTS of them gives
+// offset and skew. The slope is the median of the slopes between points half
+// the history apart (long baselines, outliers ignored) and the intercept the
+// median residual, so a window spoiled by a delivery stall does not move it.
+//
+// A sample that arrives earlier than the line predicts lowers the line at
+// once: a mapped time is never later than the arrival. Mapped times never go
+// backwards.
+class DeviceClockSync {
+public:
+    static const uint64_t WINDOW_US = 1000000;
+    static const int MAX_POINTS = 128; // about two minutes of history
+
+    // Host time of a device timestamp that arrived at arrivalUs; 0 = no device timestamp
+    uint64_t map(uint64_t deviceUs, uint64_t arrivalUs);
+
+    void reset();
+
+    bool synced() const { return synced_; }
+    double offsetUs() const { return intercept_; } // host - device at the reference device time
+    double skewPpm() const { return slope_ * 1e6; }
+    int points() const { return pointCount_; }
+
+private:
+    struct Point {
+        double deviceUs; // relative to originUs_
+        double offsetUs; // arrival - device
+    };
+
+    void closeWindow();
+    void fit();
+    double predict(double deviceUs) const { return intercept_ + slope_ * deviceUs; }
+
+    bool synced_ = false;
+    uint64_t originUs_ = 0; // device time of the first sample, keeps the doubles small
+    uint64_t lastMappedUs_ = 0;
+
+    // Lowest offset of the current window
+    bool windowOpen_ = false;
+    uint64_t windowEndUs_ = 0; // device time
+    Point windowMin_ = {0, 0};
+
+    Point points_[MAX_POINTS];
+    int pointCount_ = 0;
+    int nextPoint_ = 0;
+
+    double intercept_ = 0.0;
+    double slope_ = 0.0;
+    double scratch_[MAX_POINTS];
+};
+
+#endif // CLOCK_SYNC_H
@@ -1,6 +1,6 @@
 #!/bin/bash
 
-g++ -o ps5_kontroller main.cpp \
+g++ -std=c++17 -o ps5_kontroller main.cpp clock_sync.cpp controller_cache.cpp crc32.cpp dualsense_calibration.cpp dualsense_decoder.cpp dualsense_output.cpp filter_chain.cpp gesture_detector.cpp gyro_bias.cpp hid_backend.cpp hidraw_backend.cpp imu_resampler.cpp input_state.cpp latency_probe.cpp orientation_fusion.cpp osc_batcher.cpp osc_encoder.cpp osc_fanout.cpp output_control.cpp report_loss.cpp sdl_backend.cpp shm_output.cpp udp_transport.cpp \
     -I/Library/Frameworks/SDL2.framework/Headers \
     -I/opt/homebrew/include \
     -L/opt/homebrew/lib \
@@ -0,0 +1,45 @@
+#include "controller_cache.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+static bool makeDirectory(const char* path) {
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+bool controllerCachePath(const char* kind, const char* serial, char* path, size_t size) {
+    if (!serial || !serial[0]) {
+        return false;
+    }
+
+    char directory[512];
+    const char* cacheHome = getenv("XDG_CACHE_HOME");
+    if (cacheHome && cacheHome[0]) {
+        snprintf(directory, sizeof(directory), "%s/ps5_kontroller", cacheHome);
+    } else {
+        const char* home = getenv("HOME");
+        if (!home || !home[0]) {
+            return false;
+        }
+        snprintf(directory, sizeof(directory), "%s/.cache", home);
+        if (!makeDirectory(directory)) {
+            return false;
+        }
+        snprintf(directory, sizeof(directory), "%s/.cache/ps5_kontroller", home);
+    }
+    if (!makeDirectory(directory)) {
+        return false;
+    }
+
+    char name[64];
+    size_t n = 0;
+    for (; serial[n] && n + 1 < sizeof(name); ++n) {
+        unsigned char c = (unsigned char)serial[n];
+        name[n] = isalnum(c) || c == '_' ? (char)c : '-';
+    }
+    name[n] = '\0';
+    return snprintf(path, size, "%s/%s-%s", directory, kind, name) < (int)size;
+}
@@ -0,0 +1,15 @@
+#ifndef CONTROLLER_CACHE_H
+#define CONTROLLER_CACHE_H
+
+#include <stddef.h>
+
+// Small per-controller files kept between runs, one per kind of data and
+// controller serial, in $XDG_CACHE_HOME/ps5_kontroller (~/.cache/ps5_kontroller
+// without it). Serials are Bluetooth addresses or USB serial numbers; any
+// character that does not belong in a file name becomes '-'.
+
+// Path of the file for kind and serial, creating the directory if needed.
+// False without a serial or a home directory.
+bool controllerCachePath(const char* kind, const char* serial, char* path, size_t size);
+
+#endif // CONTROLLER_CACHE_H
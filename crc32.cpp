@@ -0,0 +1,54 @@
+#include "crc32.h"
+
+namespace {
+
+struct Crc32Tables {
+    uint32_t t[8][256];
+
+    constexpr Crc32Tables() : t() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+            }
+            t[0][i] = crc;
+        }
+        // t[k][i]: CRC of byte i followed by k zero bytes
+        for (int k = 1; k < 8; ++k) {
+            for (uint32_t i = 0; i < 256; ++i) {
+                t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+constexpr Crc32Tables TABLES;
+
+inline uint32_t load32le(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+} // namespace
+
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length) {
+    const uint32_t (*t)[256] = TABLES.t;
+    while (length >= 8) {
+        uint32_t lo = load32le(data) ^ crc;
+        uint32_t hi = load32le(data + 4);
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        data += 8;
+        length -= 8;
+    }
+    while (length--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+uint32_t crc32UpdateBytewise(uint32_t crc, const uint8_t* data, size_t length) {
+    while (length--) {
+        crc = (crc >> 8) ^ TABLES.t[0][(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
@@ -0,0 +1,69 @@
+#ifndef DUALSENSE_H
+#define DUALSENSE_H
+
+#include <stdint.h>
+#include "crc32.h"
+
+// DualSense VID/PID
+#define DS_VENDOR_ID 0x054c
+#define DS_PRODUCT_ID 0x0ce6
+
+// DualSense input reports; the field offsets of each variant are in dualsense_layout.h
+#define DS_INPUT_REPORT_USB 0x01
+#define DS_INPUT_REPORT_USB_SIZE 64
+
+// Over Bluetooth the extended report carries the same payload one byte later
+// (after a sequence/tag byte) and ends in a CRC32 over a 0xA1 seed byte and
+// everything before the CRC. Until the controller is switched to extended
+// reports (by reading a feature report) it sends a short 0x01 without sensors.
+#define DS_INPUT_REPORT_BT 0x31
+#define DS_INPUT_REPORT_BT_SIMPLE_SIZE 10
+#define DS_INPUT_REPORT_BT_SIZE 78
+#define DS_INPUT_REPORT_BT_PAYLOAD_SHIFT 1
+#define DS_INPUT_REPORT_BT_CRC_OFFSET 74
+#define DS_INPUT_CRC32_SEED 0xA1
+
+// Reading the calibration feature report enables extended Bluetooth reports
+#define DS_FEATURE_REPORT_CALIBRATION 0x05
+#define DS_FEATURE_REPORT_CALIBRATION_SIZE 41
+
+// Output reports (rumble, lights, trigger effects). Both carry the same
+// 47-byte block of settings, each group applied only when its valid flag is
+// set. Over Bluetooth it follows a sequence/tag byte and a tag, and the report
+// ends in a CRC32 seeded with 0xA2.
+#define DS_OUTPUT_REPORT_USB 0x02
+#define DS_OUTPUT_REPORT_USB_SIZE 48
+#define DS_OUTPUT_REPORT_BT 0x31
+#define DS_OUTPUT_REPORT_BT_SIZE 78
+#define DS_OUTPUT_REPORT_BT_CRC_OFFSET 74
+#define DS_OUTPUT_CRC32_SEED 0xA2
+#define DS_OUTPUT_TAG 0x10
+#define DS_OUTPUT_COMMON_SIZE 47
+#define DS_TRIGGER_EFFECT_SIZE 11
+
+// Nominal sensor resolution of the raw reports (a +-2000 deg/s gyro), used
+// until per-controller calibration is applied
+#define DS_GYRO_RES_PER_DEG_S 16
+#define DS_ACC_RES_PER_G 8192
+
+// The sensor timestamp counts in units of 1/3 microsecond
+#define DS_SENSOR_TICKS_PER_US 3
+
+// Unaligned little-endian fields of a raw report
+inline int16_t dsReadLe16(const uint8_t* p) {
+    return (int16_t)(uint16_t)(p[0] | (p[1] << 8));
+}
+
+inline uint32_t dsReadLe32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Verify the trailing CRC32 of a Bluetooth input report, stored at crcOffset
+inline bool dsBluetoothCrcValid(const uint8_t* report, int crcOffset = DS_INPUT_REPORT_BT_CRC_OFFSET) {
+    static const uint8_t seed = DS_INPUT_CRC32_SEED;
+    static const uint32_t seeded = crc32Update(CRC32_INIT, &seed, 1);
+    uint32_t crc = ~crc32Update(seeded, report, crcOffset);
+    return crc == dsReadLe32(&report[crcOffset]);
+}
+
+#endif // DUALSENSE_H
@@ -0,0 +1,146 @@
+#include "dualsense_calibration.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "controller_cache.h"
+
+static const char CACHE_KIND[] = "calibration";
+static const char CACHE_HEADER[] = "ps5_kontroller calibration 1";
+
+static const DsField AXIS_FIELDS[IMU_AXES] = {
+    DS_FIELD_GYRO_X, DS_FIELD_GYRO_Y, DS_FIELD_GYRO_Z, DS_FIELD_ACCEL_X, DS_FIELD_ACCEL_Y, DS_FIELD_ACCEL_Z,
+};
+
+// Offsets in feature report 0x05; the gyro ranges are stored per axis as plus, minus
+enum {
+    CALIBRATION_GYRO_BIAS = 1,
+    CALIBRATION_GYRO_RANGE = 7,
+    CALIBRATION_GYRO_SPEED_PLUS = 19,
+    CALIBRATION_GYRO_SPEED_MINUS = 21,
+    CALIBRATION_ACCEL_RANGE = 23,
+    CALIBRATION_END = 35,
+};
+
+ImuAxisScale imuNominalScale(const DsReportLayout& layout) {
+    ImuAxisScale scale;
+    for (int a = 0; a < IMU_AXES; ++a) {
+        scale.scale[a] = layout.fields[AXIS_FIELDS[a]].scale;
+        scale.offset[a] = 0.0f;
+    }
+    return scale;
+}
+
+bool dsParseCalibration(const uint8_t* report, int length, DsCalibration* calibration) {
+    if (length < CALIBRATION_END || report[0] != DS_FEATURE_REPORT_CALIBRATION) {
+        return false;
+    }
+    for (int i = 0; i < 3; ++i) {
+        calibration->gyroBias[i] = dsReadLe16(&report[CALIBRATION_GYRO_BIAS + 2 * i]);
+        calibration->gyroPlus[i] = dsReadLe16(&report[CALIBRATION_GYRO_RANGE + 4 * i]);
+        calibration->gyroMinus[i] = dsReadLe16(&report[CALIBRATION_GYRO_RANGE + 4 * i + 2]);
+        calibration->accelPlus[i] = dsReadLe16(&report[CALIBRATION_ACCEL_RANGE + 4 * i]);
+        calibration->accelMinus[i] = dsReadLe16(&report[CALIBRATION_ACCEL_RANGE + 4 * i + 2]);
+    }
+    calibration->gyroSpeedPlus = dsReadLe16(&report[CALIBRATION_GYRO_SPEED_PLUS]);
+    calibration->gyroSpeedMinus = dsReadLe16(&report[CALIBRATION_GYRO_SPEED_MINUS]);
+    return true;
+}
+
+// A calibrated scale more than a factor of two from nominal is a bad report, not a sensor
+static bool plausible(float scale, float nominal) {
+    return scale > 0.5f * nominal && scale < 2.0f * nominal;
+}
+
+ImuAxisScale dsCalibrationScale(const DsCalibration& calibration, int* invalidAxes) {
+    const float DEGREES_TO_RADIANS = 3.14159265f / 180.0f;
+    const float STANDARD_GRAVITY = 9.80665f;
+
+    ImuAxisScale nominal = imuNominalScale(DS_LAYOUT_USB);
+    ImuAxisScale result = nominal;
+    int invalid = 0;
+
+    // deg/s = (raw - bias) * (speed+ + speed-) / (plus - minus)
+    float speed = (float)calibration.gyroSpeedPlus + calibration.gyroSpeedMinus;
+    for (int i = 0; i < 3; ++i) {
+        float range = (float)calibration.gyroPlus[i] - calibration.gyroMinus[i];
+        float scale = range > 0.0f ? speed / range * DEGREES_TO_RADIANS : 0.0f;
+        if (plausible(scale, nominal.scale[i])) {
+            result.scale[i] = scale;
+            result.offset[i] = -calibration.gyroBias[i] * scale;
+        } else {
+            invalid++;
+        }
+    }
+
+    // g = (raw - centre) * 2 / (plus - minus), the centre halfway between +1 g and -1 g
+    for (int i = 0; i < 3; ++i) {
+        float range = (float)calibration.accelPlus[i] - calibration.accelMinus[i];
+        float scale = range > 0.0f ? 2.0f * STANDARD_GRAVITY / range : 0.0f;
+        if (plausible(scale, nominal.scale[3 + i])) {
+            float centre = calibration.accelPlus[i] - range / 2.0f;
+            result.scale[3 + i] = scale;
+            result.offset[3 + i] = -centre * scale;
+        } else {
+            invalid++;
+        }
+    }
+
+    if (invalidAxes) {
+        *invalidAxes = invalid;
+    }
+    return result;
+}
+
+bool dsLoadCalibration(const char* serial, DsCalibration* calibration) {
+    char path[600];
+    if (!controllerCachePath(CACHE_KIND, serial, path, sizeof(path))) {
+        return false;
+    }
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    char header[64] = {0};
+    int v[17];
+    bool ok = fgets(header, sizeof(header), file) && strncmp(header, CACHE_HEADER, sizeof(CACHE_HEADER) - 1) == 0 &&
+              fscanf(file, " gyro_bias %d %d %d", &v[0], &v[1], &v[2]) == 3 &&
+              fscanf(file, " gyro_plus %d %d %d", &v[3], &v[4], &v[5]) == 3 &&
+              fscanf(file, " gyro_minus %d %d %d", &v[6], &v[7], &v[8]) == 3 &&
+              fscanf(file, " gyro_speed %d %d", &v[9], &v[10]) == 2 &&
+              fscanf(file, " accel_plus %d %d %d", &v[11], &v[12], &v[13]) == 3 &&
+              fscanf(file, " accel_minus %d %d %d", &v[14], &v[15], &v[16]) == 3;
+    fclose(file);
+    if (!ok) {
+        return false;
+    }
+    for (int i = 0; i < 3; ++i) {
+        calibration->gyroBias[i] = (int16_t)v[i];
+        calibration->gyroPlus[i] = (int16_t)v[3 + i];
+        calibration->gyroMinus[i] = (int16_t)v[6 + i];
+        calibration->accelPlus[i] = (int16_t)v[11 + i];
+        calibration->accelMinus[i] = (int16_t)v[14 + i];
+    }
+    calibration->gyroSpeedPlus = (int16_t)v[9];
+    calibration->gyroSpeedMinus = (int16_t)v[10];
+    return true;
+}
+
+bool dsSaveCalibration(const char* serial, const DsCalibration& calibration) {
+    char path[600];
+    if (!controllerCachePath(CACHE_KIND, serial, path, sizeof(path))) {
+        return false;
+    }
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    const DsCalibration& c = calibration;
+    fprintf(file, "%s\n", CACHE_HEADER);
+    fprintf(file, "gyro_bias %d %d %d\n", c.gyroBias[0], c.gyroBias[1], c.gyroBias[2]);
+    fprintf(file, "gyro_plus %d %d %d\n", c.gyroPlus[0], c.gyroPlus[1], c.gyroPlus[2]);
+    fprintf(file, "gyro_minus %d %d %d\n", c.gyroMinus[0], c.gyroMinus[1], c.gyroMinus[2]);
+    fprintf(file, "gyro_speed %d %d\n", c.gyroSpeedPlus, c.gyroSpeedMinus);
+    fprintf(file, "accel_plus %d %d %d\n", c.accelPlus[0], c.accelPlus[1], c.accelPlus[2]);
+    fprintf(file, "accel_minus %d %d %d\n", c.accelMinus[0], c.accelMinus[1], c.accelMinus[2]);
+    return fclose(file) == 0;
+}
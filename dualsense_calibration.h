@@ -0,0 +1,46 @@
+#ifndef DUALSENSE_CALIBRATION_H
+#define DUALSENSE_CALIBRATION_H
+
+#include <stdint.h>
+#include "dualsense_layout.h"
+
+// Axis order of the scale: gyro x, y, z (pitch, yaw, roll), then accel x, y, z
+static const int IMU_AXES = 6;
+
+// Raw sensor value to SDL units (rad/s, m/s^2): raw * scale + offset, one
+// multiply-add per axis with the bias folded into the offset
+struct ImuAxisScale {
+    float scale[IMU_AXES];
+    float offset[IMU_AXES];
+};
+
+// Nominal sensor resolution of a report variant, without offsets
+ImuAxisScale imuNominalScale(const DsReportLayout& layout);
+
+// Factory calibration of one controller, as read from feature report 0x05:
+// the gyro zero point and its reading at a reference rate in both directions
+// (plus the two reference rates), and the accel reading at +1 g and -1 g
+struct DsCalibration {
+    int16_t gyroBias[3];
+    int16_t gyroPlus[3];
+    int16_t gyroMinus[3];
+    int16_t gyroSpeedPlus;
+    int16_t gyroSpeedMinus;
+    int16_t accelPlus[3];
+    int16_t accelMinus[3];
+};
+
+// Parse feature report 0x05 (report id first); false if it is not one
+bool dsParseCalibration(const uint8_t* report, int length, DsCalibration* calibration);
+
+// Per-axis scale and offset of a calibration. Axes whose calibration is
+// implausible (a zero or reversed range) keep the nominal scale; their
+// number is returned through invalidAxes.
+ImuAxisScale dsCalibrationScale(const DsCalibration& calibration, int* invalidAxes = nullptr);
+
+// The calibration cached for a controller serial (see controller_cache.h),
+// so a reconnect needs no feature report
+bool dsLoadCalibration(const char* serial, DsCalibration* calibration);
+bool dsSaveCalibration(const char* serial, const DsCalibration& calibration);
+
+#endif // DUALSENSE_CALIBRATION_H
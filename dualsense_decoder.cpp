@@ -0,0 +1,132 @@
+#include "dualsense_decoder.h"
+
+#include <stdio.h>
+
+void DualSenseDecoder::reset() {
+    ticks_.reset();
+    clock_.reset();
+    loss_.reset();
+    gyroBias_.resetWindow();
+    states_[0] = states_[1] = DsInputState();
+    delta_ = DsStateDelta();
+}
+
+bool DualSenseDecoder::decode(const uint8_t* data, int length, uint64_t arrivalUs, Sample* sample) {
+    bool decoded = false;
+    delta_ = DsStateDelta();
+    bool matched = dsVisitReport(data, length, [&](auto variant) {
+        decoded = decodeReport<decltype(variant)::layout>(data, arrivalUs, sample);
+    });
+    if (!matched) {
+        ignored_++;
+    }
+    return decoded;
+}
+
+void DualSenseDecoder::skip(const uint8_t* data, int length) {
+    dsVisitReport(data, length, [&](auto variant) {
+        constexpr const DsReportLayout& L = decltype(variant)::layout;
+        if constexpr (L.hasSensors()) {
+            if constexpr (L.crcOffset != 0) {
+                if (!dsBluetoothCrcValid(data, L.crcOffset)) {
+                    return;
+                }
+            }
+            trackLoss<L>(data);
+        }
+    });
+}
+
+// False for a repeated or late report
+template <const DsReportLayout& L>
+bool DualSenseDecoder::trackLoss(const uint8_t* report) {
+    uint32_t tick = dsFieldRaw<L, DS_FIELD_SENSOR_TIMESTAMP>(report);
+    if constexpr (L.has(DS_FIELD_SEQUENCE)) {
+        return loss_.add((uint8_t)dsFieldRaw<L, DS_FIELD_SEQUENCE>(report), tick);
+    } else {
+        return loss_.addTimeOnly(tick);
+    }
+}
+
+template <const DsReportLayout& L>
+bool DualSenseDecoder::decodeReport(const uint8_t* report, uint64_t arrivalUs, Sample* sample) {
+    if constexpr (!L.hasSensors()) {
+        bluetoothReports_++;
+        bluetooth_ = true;
+        shortReports_ = true;
+        updateState<L>(report, arrivalUs);
+        return false;
+    } else {
+        if constexpr (L.crcOffset != 0) {
+            if (!dsBluetoothCrcValid(report, L.crcOffset)) {
+                crcFailures_++;
+                return false;
+            }
+        }
+        if (L.bluetooth) {
+            bluetoothReports_++;
+        } else {
+            usbReports_++;
+        }
+        bluetooth_ = L.bluetooth;
+        shortReports_ = false;
+
+        // Repeated and late reports are dropped before they can move the sensor clock backwards
+        uint32_t tick = dsFieldRaw<L, DS_FIELD_SENSOR_TIMESTAMP>(report);
+        if (!trackLoss<L>(report)) {
+            return false;
+        }
+        uint64_t ticks = ticks_.unwrap(tick);
+
+        *sample = Sample();
+        sample->kind = SAMPLE_IMU;
+        sample->controller = controller_;
+        // One multiply-add per axis, the bias is part of the offset
+        const ImuAxisScale& s = scale_;
+        sample->data[0] = dsFieldValue<L, DS_FIELD_GYRO_X>(report) * s.scale[0] + s.offset[0];
+        sample->data[1] = dsFieldValue<L, DS_FIELD_GYRO_Y>(report) * s.scale[1] + s.offset[1];
+        sample->data[2] = dsFieldValue<L, DS_FIELD_GYRO_Z>(report) * s.scale[2] + s.offset[2];
+        sample->data[3] = dsFieldValue<L, DS_FIELD_ACCEL_X>(report) * s.scale[3] + s.offset[3];
+        sample->data[4] = dsFieldValue<L, DS_FIELD_ACCEL_Y>(report) * s.scale[4] + s.offset[4];
+        sample->data[5] = dsFieldValue<L, DS_FIELD_ACCEL_Z>(report) * s.scale[5] + s.offset[5];
+        gyroBias_.process(sample->data);
+        // A zero timestamp means "none" to the clock mapper, so count from 1 us
+        sample->timestampUs = ticks / DS_SENSOR_TICKS_PER_US + 1;
+        sample->hostTimeUs = clock_.map(sample->timestampUs, arrivalUs);
+        updateState<L>(report, sample->hostTimeUs);
+        return true;
+    }
+}
+
+template <const DsReportLayout& L>
+void DualSenseDecoder::updateState(const uint8_t* report, uint64_t hostTimeUs) {
+    const DsInputState& previous = states_[current_];
+    current_ ^= 1;
+    dsDecodeState<L>(report, previous, &states_[current_]);
+    delta_ = dsDiffState(previous, states_[current_]);
+    if (delta_.fields != 0) {
+        stateTimeUs_ = hostTimeUs;
+    }
+}
+
+void DualSenseDecoder::reportCrcFailures(const char* label) {
+    if (crcFailures_ != crcFailuresReported_) {
+        printf("%s: %llu Bluetooth reports failed the CRC check\n", label,
+               (unsigned long long)(crcFailures_ - crcFailuresReported_));
+        crcFailuresReported_ = crcFailures_;
+    }
+}
+
+void DualSenseDecoder::printStats(const char* label) const {
+    printf("%s: %llu USB reports, %llu Bluetooth reports, %llu CRC failures, %llu ignored\n", label,
+           (unsigned long long)usbReports_, (unsigned long long)bluetoothReports_,
+           (unsigned long long)crcFailures_, (unsigned long long)ignored_);
+    const ReportLossStats& loss = loss_.totals();
+    printf("%s: %llu reports dropped (%.2f%%), %llu duplicated, %llu out of order\n", label,
+           (unsigned long long)loss.dropped, loss.lossPercent(), (unsigned long long)loss.duplicated,
+           (unsigned long long)loss.outOfOrder);
+    if (clock_.synced()) {
+        printf("%s: sensor clock %+.1f ppm against the host, fitted over %d s\n", label, clock_.skewPpm(),
+               clock_.points());
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef DUALSENSE_DECODER_H
+#define DUALSENSE_DECODER_H
+
+#include <stdint.h>
+#include "dualsense.h"
+#include "dualsense_layout.h"
+#include "report_loss.h"
+#include "clock_sync.h"
+#include "dualsense_calibration.h"
+#include "gyro_bias.h"
+#include "input_state.h"
+#include "sample.h"
+
+// Turns the raw input reports of one DualSense, over USB (0x01) or Bluetooth
+// (0x31, CRC checked), into SAMPLE_IMU records. Gyro and accel of a report
+// come from the same instant; they are scaled to the units SDL uses (rad/s and
+// m/s^2) with the controller's calibration once it is set, the nominal sensor
+// resolution before. The report variants and their fields come from the
+// tables in dualsense_layout.h. The gyro bias learned while the controller
+// lies still is subtracted from every sample (see GyroBiasEstimator).
+//
+// Every report, the short Bluetooth one included, also updates the packed
+// input state; delta() says what the last report changed.
+class DualSenseDecoder {
+public:
+    explicit DualSenseDecoder(int32_t controller = 0) : controller_(controller) {}
+
+    // Start over for a (re)opened device; keeps the calibration and gyro bias
+    void reset();
+
+    // Per-axis scale and offset of this controller, e.g. dsCalibrationScale()
+    void setCalibration(const ImuAxisScale& scale) { scale_ = scale; }
+
+    // Decode one report read at arrivalUs. False if it carries no sensor data,
+    // failed the CRC check or repeats or predates a report already decoded;
+    // all of these are counted.
+    bool decode(const uint8_t* data, int length, uint64_t arrivalUs, Sample* sample);
+
+    // Count a report that was received but is not decoded, such as one
+    // superseded by a newer report, so the loss tracker does not take it for
+    // a gap. Leaves the sensor clock and the input state alone.
+    void skip(const uint8_t* data, int length);
+
+    // Input state after the last report and what that report changed; the
+    // delta is empty for a report that was not decoded
+    const DsInputState& state() const { return states_[current_]; }
+    const DsStateDelta& delta() const { return delta_; }
+    uint64_t stateTimeUs() const { return stateTimeUs_; } // host time of the last state change
+
+    int32_t controller() const { return controller_; }
+    bool bluetooth() const { return bluetooth_; } // transport of the last decoded report
+    bool shortReports() const { return shortReports_; } // the last report was the short Bluetooth one, without sensors
+    uint64_t usbReports() const { return usbReports_; }
+    uint64_t bluetoothReports() const { return bluetoothReports_; }
+    uint64_t crcFailures() const { return crcFailures_; }
+    uint64_t ignored() const { return ignored_; }
+    ReportLossTracker& loss() { return loss_; }
+    GyroBiasEstimator& gyroBias() { return gyroBias_; }
+
+    // Print the CRC failures since the previous call, if any
+    void reportCrcFailures(const char* label);
+    void printStats(const char* label) const;
+
+private:
+    template <const DsReportLayout& L>
+    bool decodeReport(const uint8_t* report, uint64_t arrivalUs, Sample* sample);
+    template <const DsReportLayout& L>
+    bool trackLoss(const uint8_t* report);
+    template <const DsReportLayout& L>
+    void updateState(const uint8_t* report, uint64_t hostTimeUs);
+
+    int32_t controller_;
+    bool bluetooth_ = false;
+    bool shortReports_ = false;
+    ImuAxisScale scale_ = imuNominalScale(DS_LAYOUT_USB);
+    GyroBiasEstimator gyroBias_;
+    DeviceClockSync clock_;
+    TickUnwrapper ticks_; // the 32-bit sensor clock wraps after about 24 minutes
+    ReportLossTracker loss_;
+    DsInputState states_[2] = {}; // current and previous, alternating
+    int current_ = 0;
+    DsStateDelta delta_;
+    uint64_t stateTimeUs_ = 0;
+
+    uint64_t usbReports_ = 0;
+    uint64_t bluetoothReports_ = 0;
+    uint64_t crcFailures_ = 0; // Bluetooth reports dropped for a bad CRC
+    uint64_t crcFailuresReported_ = 0;
+    uint64_t ignored_ = 0;     // reports of another type or length
+};
+
+#endif // DUALSENSE_DECODER_H
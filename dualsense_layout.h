@@ -0,0 +1,208 @@
+#ifndef DUALSENSE_LAYOUT_H
+#define DUALSENSE_LAYOUT_H
+
+#include <stdint.h>
+#include <string.h>
+#include "dualsense.h"
+
+// Compile-time description of the DualSense input report variants.
+//
+// Every variant is a table of where each field sits, how wide it is, whether
+// it is signed and what one LSB is worth. dsFieldRaw/dsFieldValue/dsFieldScaled
+// are instantiated per variant and field, so each read compiles down to byte
+// loads at a constant offset (a single unaligned load for 16 and 32-bit
+// fields on little-endian hosts): no alignment assumptions, no branches.
+// A new report variant is a table plus an entry in DsReportLayouts.
+
+enum DsField : uint8_t {
+    DS_FIELD_LEFT_X,
+    DS_FIELD_LEFT_Y,
+    DS_FIELD_RIGHT_X,
+    DS_FIELD_RIGHT_Y,
+    DS_FIELD_L2,
+    DS_FIELD_R2,
+    DS_FIELD_SEQUENCE,         // report counter, wraps at 256
+    DS_FIELD_BUTTONS,          // d-pad and face buttons, shoulders and sticks, PS/touchpad/mute
+    DS_FIELD_GYRO_X,
+    DS_FIELD_GYRO_Y,
+    DS_FIELD_GYRO_Z,
+    DS_FIELD_ACCEL_X,
+    DS_FIELD_ACCEL_Y,
+    DS_FIELD_ACCEL_Z,
+    DS_FIELD_SENSOR_TIMESTAMP, // 1/3 us ticks, wraps after about 24 minutes
+    DS_FIELD_TOUCH_0,          // contact byte (bit 7 = not touching, id), then 12-bit x and y
+    DS_FIELD_TOUCH_1,
+    DS_FIELD_BATTERY,          // charge level in the low nibble, charging state in the high nibble
+    DS_FIELD_PLUGS,            // bit 0 headphones, bit 1 microphone
+    DS_FIELD_COUNT
+};
+
+struct DsFieldLayout {
+    uint8_t offset; // from the report id byte
+    uint8_t width;  // bytes (1 to 4), 0 = not carried by this variant
+    bool isSigned;
+    float scale;    // units per LSB for dsFieldScaled
+};
+
+struct DsReportLayout {
+    const char* name;
+    uint8_t reportId;
+    uint8_t size;       // minimum length of a report of this variant
+    uint8_t crcOffset;  // trailing CRC32 (seeded with DS_INPUT_CRC32_SEED), 0 = none
+    bool bluetooth;
+    DsFieldLayout fields[DS_FIELD_COUNT];
+    uint32_t buttonMask = 0xFFFFFF; // bits of DS_FIELD_BUTTONS that are buttons
+
+    constexpr bool has(DsField field) const { return fields[field].width != 0; }
+    constexpr bool hasSensors() const { return has(DS_FIELD_GYRO_X) && has(DS_FIELD_ACCEL_X); }
+};
+
+// Units of the scaled sensor fields, matching what SDL reports
+static constexpr float DS_GYRO_SCALE = 3.14159265f / 180.0f / DS_GYRO_RES_PER_DEG_S; // rad/s per LSB
+static constexpr float DS_ACCEL_SCALE = 9.80665f / DS_ACC_RES_PER_G;                 // m/s^2 per LSB
+
+constexpr DsFieldLayout dsUnsigned(uint8_t offset, uint8_t width, float scale = 1.0f) {
+    return DsFieldLayout{offset, width, false, scale};
+}
+
+constexpr DsFieldLayout dsSigned(uint8_t offset, uint8_t width, float scale = 1.0f) {
+    return DsFieldLayout{offset, width, true, scale};
+}
+
+// Full USB report 0x01; the offsets follow dualsensectl and hid-playstation
+constexpr DsReportLayout dsUsbLayout() {
+    DsReportLayout layout = {"usb", DS_INPUT_REPORT_USB, DS_INPUT_REPORT_USB_SIZE, 0, false, {}};
+    layout.fields[DS_FIELD_LEFT_X] = dsUnsigned(1, 1);
+    layout.fields[DS_FIELD_LEFT_Y] = dsUnsigned(2, 1);
+    layout.fields[DS_FIELD_RIGHT_X] = dsUnsigned(3, 1);
+    layout.fields[DS_FIELD_RIGHT_Y] = dsUnsigned(4, 1);
+    layout.fields[DS_FIELD_L2] = dsUnsigned(5, 1);
+    layout.fields[DS_FIELD_R2] = dsUnsigned(6, 1);
+    layout.fields[DS_FIELD_SEQUENCE] = dsUnsigned(7, 1);
+    layout.fields[DS_FIELD_BUTTONS] = dsUnsigned(8, 3);
+    layout.fields[DS_FIELD_GYRO_X] = dsSigned(16, 2, DS_GYRO_SCALE);
+    layout.fields[DS_FIELD_GYRO_Y] = dsSigned(18, 2, DS_GYRO_SCALE);
+    layout.fields[DS_FIELD_GYRO_Z] = dsSigned(20, 2, DS_GYRO_SCALE);
+    layout.fields[DS_FIELD_ACCEL_X] = dsSigned(22, 2, DS_ACCEL_SCALE);
+    layout.fields[DS_FIELD_ACCEL_Y] = dsSigned(24, 2, DS_ACCEL_SCALE);
+    layout.fields[DS_FIELD_ACCEL_Z] = dsSigned(26, 2, DS_ACCEL_SCALE);
+    layout.fields[DS_FIELD_SENSOR_TIMESTAMP] = dsUnsigned(28, 4, 1.0f / DS_SENSOR_TICKS_PER_US);
+    layout.fields[DS_FIELD_TOUCH_0] = dsUnsigned(33, 4);
+    layout.fields[DS_FIELD_TOUCH_1] = dsUnsigned(37, 4);
+    layout.fields[DS_FIELD_BATTERY] = dsUnsigned(53, 1);
+    layout.fields[DS_FIELD_PLUGS] = dsUnsigned(54, 1);
+    return layout;
+}
+
+// The extended Bluetooth report 0x31 carries the USB payload one byte later
+constexpr DsReportLayout dsBluetoothLayout() {
+    DsReportLayout layout = dsUsbLayout();
+    layout.name = "bt";
+    layout.reportId = DS_INPUT_REPORT_BT;
+    layout.size = DS_INPUT_REPORT_BT_SIZE;
+    layout.crcOffset = DS_INPUT_REPORT_BT_CRC_OFFSET;
+    layout.bluetooth = true;
+    for (DsFieldLayout& field : layout.fields) {
+        field.offset += DS_INPUT_REPORT_BT_PAYLOAD_SHIFT;
+    }
+    return layout;
+}
+
+// The short Bluetooth report sent until the calibration feature report is read:
+// sticks, buttons and triggers only
+constexpr DsReportLayout dsBluetoothSimpleLayout() {
+    DsReportLayout layout = {"bt-simple", DS_INPUT_REPORT_USB, DS_INPUT_REPORT_BT_SIMPLE_SIZE, 0, true, {}};
+    layout.fields[DS_FIELD_LEFT_X] = dsUnsigned(1, 1);
+    layout.fields[DS_FIELD_LEFT_Y] = dsUnsigned(2, 1);
+    layout.fields[DS_FIELD_RIGHT_X] = dsUnsigned(3, 1);
+    layout.fields[DS_FIELD_RIGHT_Y] = dsUnsigned(4, 1);
+    layout.fields[DS_FIELD_BUTTONS] = dsUnsigned(5, 3);
+    layout.buttonMask = 0x03FFFF; // bits 2-7 of the third byte are a report counter, there is no mute button
+    layout.fields[DS_FIELD_L2] = dsUnsigned(8, 1);
+    layout.fields[DS_FIELD_R2] = dsUnsigned(9, 1);
+    return layout;
+}
+
+inline constexpr DsReportLayout DS_LAYOUT_USB = dsUsbLayout();
+inline constexpr DsReportLayout DS_LAYOUT_BT = dsBluetoothLayout();
+inline constexpr DsReportLayout DS_LAYOUT_BT_SIMPLE = dsBluetoothSimpleLayout();
+
+static_assert(DS_LAYOUT_BT.fields[DS_FIELD_GYRO_X].offset == 17, "Bluetooth payload starts one byte after USB");
+static_assert(DS_LAYOUT_USB.fields[DS_FIELD_PLUGS].offset < DS_INPUT_REPORT_USB_SIZE, "USB fields fit the report");
+static_assert(DS_LAYOUT_BT.fields[DS_FIELD_PLUGS].offset < DS_INPUT_REPORT_BT_CRC_OFFSET, "Bluetooth fields end before the CRC");
+
+// Field bits as stored, zero-extended. Zero for a field the variant does not carry.
+template <const DsReportLayout& L, DsField F>
+inline uint32_t dsFieldRaw(const uint8_t* report) {
+    constexpr DsFieldLayout field = L.fields[F];
+    static_assert(field.width <= 4, "fields are at most 32 bits wide");
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Report fields are little-endian like the host; a memcpy is one unaligned load
+    if constexpr (field.width == 2) {
+        uint16_t raw;
+        memcpy(&raw, report + field.offset, sizeof(raw));
+        return raw;
+    } else if constexpr (field.width == 4) {
+        uint32_t raw;
+        memcpy(&raw, report + field.offset, sizeof(raw));
+        return raw;
+    }
+#endif
+    uint32_t raw = 0;
+    for (unsigned i = 0; i < field.width; ++i) {
+        raw |= (uint32_t)report[field.offset + i] << (8 * i);
+    }
+    return raw;
+}
+
+// Field value, sign-extended if the field is signed
+template <const DsReportLayout& L, DsField F>
+inline int32_t dsFieldValue(const uint8_t* report) {
+    constexpr DsFieldLayout field = L.fields[F];
+    uint32_t raw = dsFieldRaw<L, F>(report);
+    if constexpr (field.isSigned && field.width == 2) {
+        return (int16_t)(uint16_t)raw;
+    } else if constexpr (field.isSigned && field.width > 0 && field.width < 4) {
+        constexpr uint32_t sign = 1u << (8 * field.width - 1);
+        return (int32_t)((raw ^ sign) - sign);
+    } else {
+        return (int32_t)raw;
+    }
+}
+
+// Field value times its scale
+template <const DsReportLayout& L, DsField F>
+inline float dsFieldScaled(const uint8_t* report) {
+    constexpr float scale = L.fields[F].scale;
+    return (float)dsFieldValue<L, F>(report) * scale;
+}
+
+// The report variants in the order they are matched; the first whose id and
+// minimum length fit a report wins, so longer variants sharing an id go first.
+template <const DsReportLayout&... L>
+struct DsLayoutList {};
+
+using DsReportLayouts = DsLayoutList<DS_LAYOUT_USB, DS_LAYOUT_BT, DS_LAYOUT_BT_SIMPLE>;
+
+// Passes the variant to a generic visitor as a type, so the visitor can instantiate the extractors
+template <const DsReportLayout& L>
+struct DsLayoutTag {
+    static constexpr const DsReportLayout& layout = L;
+};
+
+// Calls visit(DsLayoutTag<L>()) for the variant of a report; false if none matches
+template <typename Visitor, const DsReportLayout&... L>
+inline bool dsVisitReport(DsLayoutList<L...>, const uint8_t* data, int length, Visitor&& visit) {
+    bool matched = false;
+    (void)((!matched && data[0] == L.reportId && length >= L.size
+                ? (matched = true, visit(DsLayoutTag<L>()), 0)
+                : 0), ...);
+    return matched;
+}
+
+template <typename Visitor>
+inline bool dsVisitReport(const uint8_t* data, int length, Visitor&& visit) {
+    return dsVisitReport(DsReportLayouts(), data, length, visit);
+}
+
+#endif // DUALSENSE_LAYOUT_H
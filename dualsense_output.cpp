@@ -0,0 +1,211 @@
+#include "dualsense_output.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Offsets within the settings block
+enum {
+    COMMON_VALID_FLAG0 = 0,
+    COMMON_VALID_FLAG1 = 1,
+    COMMON_MOTOR_RIGHT = 2,
+    COMMON_MOTOR_LEFT = 3,
+    COMMON_MUTE_LED = 8,
+    COMMON_RIGHT_TRIGGER = 10,
+    COMMON_LEFT_TRIGGER = 21,
+    COMMON_VALID_FLAG2 = 38,
+    COMMON_LIGHTBAR_SETUP = 41,
+    COMMON_PLAYER_LEDS = 43,
+    COMMON_LIGHTBAR = 44,
+};
+
+// Valid flags
+enum : uint8_t {
+    FLAG0_COMPATIBLE_VIBRATION = 0x01,
+    FLAG0_HAPTICS_SELECT = 0x02,
+    FLAG0_RIGHT_TRIGGER = 0x04,
+    FLAG0_LEFT_TRIGGER = 0x08,
+    FLAG1_MUTE_LED = 0x01,
+    FLAG1_LIGHTBAR = 0x04,
+    FLAG1_PLAYER_LEDS = 0x10,
+    FLAG2_LIGHTBAR_SETUP = 0x02,
+    LIGHTBAR_SETUP_LIGHT_OUT = 0x02,
+};
+
+void dsBuildOutputCommon(const DsOutputState& state, uint32_t groups, uint8_t* common) {
+    memset(common, 0, DS_OUTPUT_COMMON_SIZE);
+    if (groups & DS_OUTPUT_RUMBLE) {
+        common[COMMON_VALID_FLAG0] |= FLAG0_COMPATIBLE_VIBRATION | FLAG0_HAPTICS_SELECT;
+        common[COMMON_MOTOR_RIGHT] = state.rumbleHigh;
+        common[COMMON_MOTOR_LEFT] = state.rumbleLow;
+    }
+    if (groups & DS_OUTPUT_TRIGGER_RIGHT) {
+        common[COMMON_VALID_FLAG0] |= FLAG0_RIGHT_TRIGGER;
+        memcpy(&common[COMMON_RIGHT_TRIGGER], state.trigger[1], DS_TRIGGER_EFFECT_SIZE);
+    }
+    if (groups & DS_OUTPUT_TRIGGER_LEFT) {
+        common[COMMON_VALID_FLAG0] |= FLAG0_LEFT_TRIGGER;
+        memcpy(&common[COMMON_LEFT_TRIGGER], state.trigger[0], DS_TRIGGER_EFFECT_SIZE);
+    }
+    if (groups & DS_OUTPUT_MUTE_LED) {
+        common[COMMON_VALID_FLAG1] |= FLAG1_MUTE_LED;
+        common[COMMON_MUTE_LED] = state.muteLed;
+    }
+    if (groups & DS_OUTPUT_LIGHTBAR) {
+        common[COMMON_VALID_FLAG1] |= FLAG1_LIGHTBAR;
+        memcpy(&common[COMMON_LIGHTBAR], state.lightbar, 3);
+    }
+    if (groups & DS_OUTPUT_LIGHTBAR_SETUP) {
+        common[COMMON_VALID_FLAG2] |= FLAG2_LIGHTBAR_SETUP;
+        common[COMMON_LIGHTBAR_SETUP] = LIGHTBAR_SETUP_LIGHT_OUT;
+    }
+    if (groups & DS_OUTPUT_PLAYER_LEDS) {
+        common[COMMON_VALID_FLAG1] |= FLAG1_PLAYER_LEDS;
+        common[COMMON_PLAYER_LEDS] = state.playerLeds & 0x1F;
+    }
+}
+
+int dsBuildOutputReport(const uint8_t* common, bool bluetooth, uint8_t sequence, uint8_t* report) {
+    if (!bluetooth) {
+        report[0] = DS_OUTPUT_REPORT_USB;
+        memcpy(&report[1], common, DS_OUTPUT_COMMON_SIZE);
+        return DS_OUTPUT_REPORT_USB_SIZE;
+    }
+
+    static const uint8_t seed = DS_OUTPUT_CRC32_SEED;
+    static const uint32_t seeded = crc32Update(CRC32_INIT, &seed, 1);
+    memset(report, 0, DS_OUTPUT_REPORT_BT_SIZE);
+    report[0] = DS_OUTPUT_REPORT_BT;
+    report[1] = (uint8_t)((sequence & 0x0F) << 4);
+    report[2] = DS_OUTPUT_TAG;
+    memcpy(&report[3], common, DS_OUTPUT_COMMON_SIZE);
+    uint32_t crc = ~crc32Update(seeded, report, DS_OUTPUT_REPORT_BT_CRC_OFFSET);
+    for (int i = 0; i < 4; ++i) {
+        report[DS_OUTPUT_REPORT_BT_CRC_OFFSET + i] = (uint8_t)(crc >> (8 * i));
+    }
+    return DS_OUTPUT_REPORT_BT_SIZE;
+}
+
+void DsOutputScheduler::setMaxRate(double hz) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    minIntervalUs_ = hz > 0 ? (uint64_t)(1000000.0 / hz) : 0;
+}
+
+void DsOutputScheduler::requested() {
+    requests_.fetch_add(1, std::memory_order_relaxed);
+    pending_.store(true, std::memory_order_release);
+}
+
+void DsOutputScheduler::setRumble(uint8_t low, uint8_t high) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wanted_.rumbleLow = low;
+    wanted_.rumbleHigh = high;
+    requested();
+}
+
+void DsOutputScheduler::setLightbar(uint8_t red, uint8_t green, uint8_t blue) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wanted_.lightbar[0] = red;
+    wanted_.lightbar[1] = green;
+    wanted_.lightbar[2] = blue;
+    requested();
+}
+
+void DsOutputScheduler::setPlayerLeds(uint8_t leds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wanted_.playerLeds = leds & 0x1F;
+    requested();
+}
+
+void DsOutputScheduler::setMuteLed(uint8_t mode) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wanted_.muteLed = mode <= DS_MUTE_LED_PULSE ? mode : (uint8_t)DS_MUTE_LED_ON;
+    requested();
+}
+
+void DsOutputScheduler::setTriggerEffect(int side, const uint8_t* effect, int length) {
+    if (side < 0 || side > 1) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    memset(wanted_.trigger[side], 0, DS_TRIGGER_EFFECT_SIZE);
+    memcpy(wanted_.trigger[side], effect, length < DS_TRIGGER_EFFECT_SIZE ? length : DS_TRIGGER_EFFECT_SIZE);
+    requested();
+}
+
+void DsOutputScheduler::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sent_ = DsOutputState();
+    lightbarSetup_ = false;
+    written_ = false;
+    // Settings made before the device came back are written again
+    pending_.store(true, std::memory_order_release);
+}
+
+bool DsOutputScheduler::take(uint64_t nowUs, DsOutputState* state, uint32_t* groups) {
+    // The common case, nothing requested, costs one load and no lock
+    if (!pending_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    if (written_ && nowUs - lastWriteUs_ < minIntervalUs_) {
+        return false; // requests keep collecting until the next slot
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.store(false, std::memory_order_relaxed);
+
+    uint32_t changed = 0;
+    if (wanted_.rumbleLow != sent_.rumbleLow || wanted_.rumbleHigh != sent_.rumbleHigh) {
+        changed |= DS_OUTPUT_RUMBLE;
+    }
+    if (memcmp(wanted_.lightbar, sent_.lightbar, sizeof(wanted_.lightbar)) != 0) {
+        changed |= DS_OUTPUT_LIGHTBAR;
+        if (!lightbarSetup_) {
+            changed |= DS_OUTPUT_LIGHTBAR_SETUP;
+            lightbarSetup_ = true;
+        }
+    }
+    if (wanted_.playerLeds != sent_.playerLeds) {
+        changed |= DS_OUTPUT_PLAYER_LEDS;
+    }
+    if (wanted_.muteLed != sent_.muteLed) {
+        changed |= DS_OUTPUT_MUTE_LED;
+    }
+    if (memcmp(wanted_.trigger[0], sent_.trigger[0], DS_TRIGGER_EFFECT_SIZE) != 0) {
+        changed |= DS_OUTPUT_TRIGGER_LEFT;
+    }
+    if (memcmp(wanted_.trigger[1], sent_.trigger[1], DS_TRIGGER_EFFECT_SIZE) != 0) {
+        changed |= DS_OUTPUT_TRIGGER_RIGHT;
+    }
+    if (changed == 0) {
+        unchanged_++;
+        return false;
+    }
+
+    sent_ = wanted_;
+    *state = wanted_;
+    *groups = changed;
+    lastWriteUs_ = nowUs;
+    written_ = true;
+    writes_++;
+    return true;
+}
+
+int DsOutputScheduler::nextReport(uint64_t nowUs, bool bluetooth, uint8_t* report) {
+    DsOutputState state;
+    uint32_t groups;
+    if (!take(nowUs, &state, &groups)) {
+        return 0;
+    }
+    uint8_t common[DS_OUTPUT_COMMON_SIZE];
+    dsBuildOutputCommon(state, groups, common);
+    int length = dsBuildOutputReport(common, bluetooth, sequence_, report);
+    sequence_ = (sequence_ + 1) & 0x0F;
+    return length;
+}
+
+void DsOutputScheduler::printStats(const char* label) const {
+    uint64_t requests = requests_.load(std::memory_order_relaxed);
+    if (requests > 0) {
+        printf("%s: %llu output requests written as %llu reports, %llu changed nothing\n", label,
+               (unsigned long long)requests, (unsigned long long)writes_, (unsigned long long)unchanged_);
+    }
+}
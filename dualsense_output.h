@@ -0,0 +1,97 @@
+#ifndef DUALSENSE_OUTPUT_H
+#define DUALSENSE_OUTPUT_H
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include "dualsense.h"
+
+// Settings of the output report, grouped the way the report enables them
+enum DsOutputGroup : uint32_t {
+    DS_OUTPUT_RUMBLE = 1 << 0,
+    DS_OUTPUT_LIGHTBAR = 1 << 1,
+    DS_OUTPUT_PLAYER_LEDS = 1 << 2,
+    DS_OUTPUT_MUTE_LED = 1 << 3,
+    DS_OUTPUT_TRIGGER_LEFT = 1 << 4,
+    DS_OUTPUT_TRIGGER_RIGHT = 1 << 5,
+    DS_OUTPUT_LIGHTBAR_SETUP = 1 << 6, // end the start-up light show so the lightbar colour shows
+};
+
+// DsOutputState::muteLed
+enum : uint8_t {
+    DS_MUTE_LED_OFF = 0,
+    DS_MUTE_LED_ON = 1,
+    DS_MUTE_LED_PULSE = 2,
+};
+
+struct DsOutputState {
+    uint8_t rumbleLow = 0;  // left, heavy motor
+    uint8_t rumbleHigh = 0; // right, light motor
+    uint8_t lightbar[3] = {0, 0, 0};
+    uint8_t playerLeds = 0; // five LEDs below the touchpad, bit 0 leftmost
+    uint8_t muteLed = DS_MUTE_LED_OFF;
+    uint8_t trigger[2][DS_TRIGGER_EFFECT_SIZE] = {}; // left, right: effect mode then its parameters
+};
+
+// The settings block shared by the USB and Bluetooth output reports, with
+// the valid flags of the given groups set
+void dsBuildOutputCommon(const DsOutputState& state, uint32_t groups, uint8_t* common);
+
+// Wrap a settings block into a USB (0x02) or Bluetooth (0x31, sequence in
+// 0..15, CRC appended) output report; returns its length
+int dsBuildOutputReport(const uint8_t* common, bool bluetooth, uint8_t sequence, uint8_t* report);
+
+// Collects rumble, light and trigger requests for one controller and turns
+// them into as few output reports as possible.
+//
+// Requests may come from any thread and only update the wanted state. The
+// thread that owns the device asks take() once per wakeup; it gets one merged
+// state with the groups that differ from what the controller already has, at
+// most maxRate times per second. Requests between two writes collapse into
+// the next one, and requests that change nothing are never written. A write
+// rate far below the input report rate leaves the (Bluetooth) link to input.
+class DsOutputScheduler {
+public:
+    void setMaxRate(double hz);
+
+    // Any thread
+    void setRumble(uint8_t low, uint8_t high);
+    void setLightbar(uint8_t red, uint8_t green, uint8_t blue);
+    void setPlayerLeds(uint8_t leds);
+    void setMuteLed(uint8_t mode);
+    // side 0 = left, 1 = right; effect holds the mode and up to 10 parameters, the rest are zero
+    void setTriggerEffect(int side, const uint8_t* effect, int length);
+
+    // Device thread: true if a write is due at nowUs, with the state to write
+    // and the groups that changed
+    bool take(uint64_t nowUs, DsOutputState* state, uint32_t* groups);
+
+    // Device thread: the output report to write at nowUs, built with take();
+    // returns its length, 0 if none is due. report holds DS_OUTPUT_REPORT_BT_SIZE bytes.
+    int nextReport(uint64_t nowUs, bool bluetooth, uint8_t* report);
+
+    // The controller was (re)opened and holds none of our settings
+    void reset();
+
+    void printStats(const char* label) const;
+
+private:
+    void requested();
+
+    std::mutex mutex_;
+    std::atomic<bool> pending_{false}; // a request came in since the last take()
+    DsOutputState wanted_;
+    DsOutputState sent_;
+    bool lightbarSetup_ = false;
+
+    uint64_t minIntervalUs_ = 10000;
+    uint64_t lastWriteUs_ = 0;
+    bool written_ = false;
+    uint8_t sequence_ = 0; // Bluetooth output sequence, 0..15
+
+    std::atomic<uint64_t> requests_{0};
+    uint64_t writes_ = 0;
+    uint64_t unchanged_ = 0; // pending requests that left the state as it was
+};
+
+#endif // DUALSENSE_OUTPUT_H
@@ -0,0 +1,367 @@
+#include "filter_chain.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const float TWO_PI = 6.28318531f;
+static const float AXIS_FULL_SCALE = 32767.0f;
+static const uint32_t IMU_AND_AXES = (1u << (FilterConfig::AXIS_LANE + FilterConfig::AXIS_LANES)) - 1;
+
+// Channel names and the lanes they stand for
+struct ChannelName {
+    const char* name;
+    uint32_t lanes;
+};
+
+static const ChannelName CHANNEL_NAMES[] = {
+    {"gyro_x", 1u << 0},        {"gyro_y", 1u << 1},         {"gyro_z", 1u << 2},
+    {"accel_x", 1u << 3},       {"accel_y", 1u << 4},        {"accel_z", 1u << 5},
+    {"left_x", 1u << 6},        {"left_y", 1u << 7},         {"right_x", 1u << 8},
+    {"right_y", 1u << 9},       {"trigger_left", 1u << 10},  {"trigger_right", 1u << 11},
+    {"gyro", 0x007},            {"accel", 0x038},            {"imu", 0x03F},
+    {"sticks", 0x3C0},          {"triggers", 0xC00},         {"axes", 0xFC0},
+};
+
+static const char* const KIND_NAMES[] = {"median", "deadzone", "lowpass", "highpass", "one_euro"};
+
+bool parseFilterSpec(const char* spec, FilterSpec* filter) {
+    memset(filter, 0, sizeof(*filter));
+
+    // Channels up to the first ':'
+    const char* kindStart = strchr(spec, ':');
+    if (!kindStart) {
+        return false;
+    }
+    const char* name = spec;
+    while (name < kindStart) {
+        const char* end = (const char*)memchr(name, ',', kindStart - name);
+        size_t length = end ? (size_t)(end - name) : (size_t)(kindStart - name);
+        uint32_t lanes = 0;
+        for (const ChannelName& channel : CHANNEL_NAMES) {
+            if (strlen(channel.name) == length && strncmp(channel.name, name, length) == 0) {
+                lanes = channel.lanes;
+            }
+        }
+        if (lanes == 0) {
+            return false;
+        }
+        filter->channels |= lanes;
+        name += length + (end ? 1 : 0);
+    }
+
+    // Kind, then up to three numbers
+    kindStart++;
+    const char* paramStart = strchr(kindStart, ':');
+    size_t kindLength = paramStart ? (size_t)(paramStart - kindStart) : strlen(kindStart);
+    int kind = -1;
+    for (int k = 0; k < 5; ++k) {
+        if (strlen(KIND_NAMES[k]) == kindLength && strncmp(KIND_NAMES[k], kindStart, kindLength) == 0) {
+            kind = k;
+        }
+    }
+    if (kind < 0) {
+        return false;
+    }
+    filter->kind = (FilterKind)kind;
+    while (paramStart && filter->paramCount < 3) {
+        char* end;
+        filter->params[filter->paramCount++] = strtof(paramStart + 1, &end);
+        if (end == paramStart + 1 || (*end != ':' && *end != '\0')) {
+            return false;
+        }
+        paramStart = *end == ':' ? end : nullptr;
+    }
+    if (paramStart || filter->paramCount == 0) {
+        return false; // too many parameters, or none
+    }
+
+    switch (filter->kind) {
+        case FILTER_MEDIAN: {
+            int n = (int)filter->params[0];
+            return n >= 3 && n <= FilterConfig::MAX_MEDIAN && (n & 1) == 1 && filter->params[0] == (float)n;
+        }
+        case FILTER_DEADZONE:
+            return filter->params[0] >= 0.0f && (filter->params[0] < 1.0f || !(filter->channels & 0xFC0));
+        default:
+            for (int i = 0; i < filter->paramCount; ++i) {
+                if (filter->params[i] < 0.0f) {
+                    return false;
+                }
+            }
+            return filter->params[0] > 0.0f;
+    }
+}
+
+FilterConfig::FilterConfig() {
+    memset(specs, 0, sizeof(specs));
+    prepare(0.0);
+}
+
+void FilterConfig::add(const FilterSpec& filter) {
+    for (int lane = 0; lane < LANES; ++lane) {
+        if (filter.channels & (1u << lane)) {
+            specs[filter.kind][lane] = filter;
+        }
+    }
+}
+
+// RBJ audio EQ cookbook low-pass or high-pass, normalised by a0
+static bool biquad(bool highPass, float cutoffHz, float q, double sampleRateHz, float* b, float* a) {
+    if (!(cutoffHz < sampleRateHz / 2.0)) {
+        return false;
+    }
+    double w0 = 2.0 * M_PI * cutoffHz / sampleRateHz;
+    double alpha = sin(w0) / (2.0 * q);
+    double c = cos(w0);
+    double a0 = 1.0 + alpha;
+    double edge = highPass ? (1.0 + c) / 2.0 : (1.0 - c) / 2.0;
+    b[0] = (float)(edge / a0);
+    b[1] = (float)((highPass ? -2.0 * edge : 2.0 * edge) / a0);
+    b[2] = (float)(edge / a0);
+    a[0] = (float)(-2.0 * c / a0);
+    a[1] = (float)((1.0 - alpha) / a0);
+    return true;
+}
+
+bool FilterConfig::prepare(double sampleRateHz) {
+    bool ok = true;
+    active = 0;
+    hasMedian = false;
+    hasEuro = false;
+    for (int lane = 0; lane < LANES; ++lane) {
+        bool axis = lane >= AXIS_LANE && lane < AXIS_LANE + AXIS_LANES;
+
+        const FilterSpec& median = specs[FILTER_MEDIAN][lane];
+        this->median[lane] = median.paramCount > 0 ? (int)median.params[0] : 1;
+        hasMedian = hasMedian || this->median[lane] > 1;
+
+        // Axes: the threshold is a fraction of full scale and the rest is stretched back to full scale
+        const FilterSpec& dz = specs[FILTER_DEADZONE][lane];
+        float threshold = dz.paramCount > 0 ? dz.params[0] : 0.0f;
+        deadzone[lane] = axis ? threshold * AXIS_FULL_SCALE : threshold;
+        deadzoneGain[lane] = axis ? 1.0f / (1.0f - threshold) : 1.0f;
+
+        for (int section = 0; section < 2; ++section) {
+            const FilterSpec& pass = specs[section == 0 ? FILTER_LOWPASS : FILTER_HIGHPASS][lane];
+            float b[3] = {1.0f, 0.0f, 0.0f};
+            float a[2] = {0.0f, 0.0f};
+            if (pass.paramCount > 0 && sampleRateHz > 0.0) {
+                float q = pass.paramCount > 1 ? pass.params[1] : 0.70710678f;
+                ok = biquad(section == 1, pass.params[0], q, sampleRateHz, b, a) && ok;
+            }
+            b0[section][lane] = b[0];
+            b1[section][lane] = b[1];
+            b2[section][lane] = b[2];
+            a1[section][lane] = a[0];
+            a2[section][lane] = a[1];
+        }
+
+        // An inactive one-euro lane still computes, with harmless values, and is blended out
+        const FilterSpec& euro = specs[FILTER_ONE_EURO][lane];
+        euroOn[lane] = euro.paramCount > 0 ? 1.0f : 0.0f;
+        euroMinCutoff[lane] = euro.paramCount > 0 ? euro.params[0] : 1.0f;
+        euroBeta[lane] = euro.paramCount > 1 ? euro.params[1] : 0.007f;
+        euroDerivativeTau[lane] = 1.0f / (TWO_PI * (euro.paramCount > 2 ? euro.params[2] : 1.0f));
+        hasEuro = hasEuro || euro.paramCount > 0;
+
+        bool on = this->median[lane] > 1 || threshold > 0.0f || specs[FILTER_LOWPASS][lane].paramCount > 0 ||
+                  specs[FILTER_HIGHPASS][lane].paramCount > 0 || euro.paramCount > 0;
+        active |= on ? 1u << lane : 0;
+    }
+    return ok;
+}
+
+FilterBank::FilterBank(const FilterConfig& config, double sampleRateHz)
+    : config_(config), nominalDt_(sampleRateHz > 0 ? (float)(1.0 / sampleRateHz) : 0.004f) {
+    // Lanes that are not started still run through the blends, so their state must be numbers
+    memset(controllers_, 0, sizeof(controllers_));
+}
+
+// The biquad and one-euro state of lanes seeing their first value x, as if it had always been there
+void FilterBank::start(Controller& controller, uint32_t lanes, const float* x) {
+    const FilterConfig& c = config_;
+    uint32_t starting = lanes & ~controller.started;
+    controller.started |= starting;
+    for (int lane = 0; starting != 0 && lane < LANES; ++lane) {
+        if (!(starting & (1u << lane))) {
+            continue;
+        }
+        float in = x[lane];
+        for (int s = 0; s < 2; ++s) {
+            float y = in * (c.b0[s][lane] + c.b1[s][lane] + c.b2[s][lane]) / (1.0f + c.a1[s][lane] + c.a2[s][lane]);
+            controller.z1[s][lane] = y - c.b0[s][lane] * in;
+            controller.z2[s][lane] = c.b2[s][lane] * in - c.a2[s][lane] * y;
+            in = y;
+        }
+        controller.euroX[lane] = in;
+        controller.euroDx[lane] = 0.0f;
+    }
+}
+
+// Every stage runs over all LANES at once; the state of lanes outside the
+// mask is kept, so they are not advanced by a sample that did not carry them
+void FilterBank::run(Controller& controller, uint32_t lanes, float dt, float* output) {
+    const FilterConfig& c = config_;
+    alignas(64) float x[LANES];
+    alignas(64) float on[LANES]; // 1 for lanes in the mask, else 0; blends keep the loops free of branches
+    for (int lane = 0; lane < LANES; ++lane) {
+        x[lane] = controller.input[lane];
+        on[lane] = (float)((lanes >> lane) & 1);
+    }
+
+    // Median: per lane, as the window size differs
+    if (c.hasMedian) {
+        for (int lane = 0; lane < LANES; ++lane) {
+            int n = c.median[lane];
+            if (n <= 1 || !(lanes & (1u << lane))) {
+                continue;
+            }
+            controller.medianWindow[controller.medianNext[lane]][lane] = x[lane];
+            controller.medianNext[lane] = (uint8_t)((controller.medianNext[lane] + 1) % n);
+            int fill = controller.medianFill[lane] < n ? ++controller.medianFill[lane] : n;
+            float sorted[FilterConfig::MAX_MEDIAN];
+            for (int i = 0; i < fill; ++i) {
+                float v = controller.medianWindow[i][lane];
+                int j = i;
+                for (; j > 0 && sorted[j - 1] > v; --j) {
+                    sorted[j] = sorted[j - 1];
+                }
+                sorted[j] = v;
+            }
+            x[lane] = sorted[fill / 2];
+        }
+    }
+
+    // Deadzone with rescale; (|m| + m) / 2 is max(m, 0)
+    for (int lane = 0; lane < LANES; ++lane) {
+        float magnitude = fabsf(x[lane]) - c.deadzone[lane];
+        x[lane] = copysignf((fabsf(magnitude) + magnitude) * 0.5f * c.deadzoneGain[lane], x[lane]);
+    }
+
+    start(controller, lanes, x);
+
+    // Low-pass, then high-pass. The state is worked on in local copies so the
+    // compiler knows it does not alias the coefficients.
+    for (int s = 0; s < 2; ++s) {
+        alignas(64) float z1[LANES];
+        alignas(64) float z2[LANES];
+        memcpy(z1, controller.z1[s], sizeof(z1));
+        memcpy(z2, controller.z2[s], sizeof(z2));
+        const float* b0 = c.b0[s];
+        const float* b1 = c.b1[s];
+        const float* b2 = c.b2[s];
+        const float* a1 = c.a1[s];
+        const float* a2 = c.a2[s];
+        for (int lane = 0; lane < LANES; ++lane) {
+            float in = x[lane];
+            float y = b0[lane] * in + z1[lane];
+            float nextZ1 = b1[lane] * in - a1[lane] * y + z2[lane];
+            float nextZ2 = b2[lane] * in - a2[lane] * y;
+            z1[lane] += on[lane] * (nextZ1 - z1[lane]);
+            z2[lane] += on[lane] * (nextZ2 - z2[lane]);
+            x[lane] = y;
+        }
+        memcpy(controller.z1[s], z1, sizeof(z1));
+        memcpy(controller.z2[s], z2, sizeof(z2));
+    }
+
+    // One-euro: the cutoff rises with the smoothed speed, so slow movement is smoothed and fast movement is not
+    if (c.hasEuro) {
+        float alphaScale = TWO_PI * dt;
+        alignas(64) float euroX[LANES];
+        alignas(64) float euroDx[LANES];
+        memcpy(euroX, controller.euroX, sizeof(euroX));
+        memcpy(euroDx, controller.euroDx, sizeof(euroDx));
+        for (int lane = 0; lane < LANES; ++lane) {
+            float in = x[lane];
+            float dx = (in - euroX[lane]) / dt;
+            float alphaDx = dt / (dt + c.euroDerivativeTau[lane]);
+            float edx = euroDx[lane] + alphaDx * (dx - euroDx[lane]);
+            float cutoff = c.euroMinCutoff[lane] + c.euroBeta[lane] * fabsf(edx);
+            float alpha = alphaScale * cutoff / (alphaScale * cutoff + 1.0f);
+            float filtered = euroX[lane] + alpha * (in - euroX[lane]);
+            euroDx[lane] += on[lane] * (edx - euroDx[lane]);
+            euroX[lane] += on[lane] * (filtered - euroX[lane]);
+            x[lane] = in + c.euroOn[lane] * (filtered - in);
+        }
+        memcpy(controller.euroX, euroX, sizeof(euroX));
+        memcpy(controller.euroDx, euroDx, sizeof(euroDx));
+    }
+
+    memcpy(output, x, sizeof(x));
+}
+
+// Clamped to the SDL axis range, then rounded half away from zero
+static int32_t roundAxis(float value) {
+    float clamped = value > 32767.0f ? 32767.0f : (value < -32768.0f ? -32768.0f : value);
+    return (int32_t)(clamped + (clamped < 0.0f ? -0.5f : 0.5f));
+}
+
+bool FilterBank::process(Sample& sample, Sample* axes, int* axisCount) {
+    *axisCount = 0;
+    if (config_.active == 0 || sample.controller < 0 || sample.controller >= MAX_CONTROLLERS) {
+        return true;
+    }
+    Controller& controller = controllers_[sample.controller];
+    alignas(64) float output[LANES];
+
+    switch (sample.kind) {
+        case SAMPLE_IMU: {
+            uint64_t timeUs = sample.timestampUs != 0 ? sample.timestampUs : sample.hostTimeUs;
+            float dt = nominalDt_;
+            if (controller.imuSeen && timeUs > controller.lastImuUs && timeUs - controller.lastImuUs < 100000) {
+                dt = (float)(timeUs - controller.lastImuUs) * 1e-6f;
+            }
+            controller.imuSeen = true;
+            controller.lastImuUs = timeUs;
+
+            // The sensors and the held axes together
+            memcpy(controller.input, sample.data, FilterConfig::IMU_LANES * sizeof(float));
+            run(controller, IMU_AND_AXES, dt, output);
+            memcpy(sample.data, output, FilterConfig::IMU_LANES * sizeof(float));
+
+            for (int a = 0; a < FilterConfig::AXIS_LANES; ++a) {
+                int lane = FilterConfig::AXIS_LANE + a;
+                int32_t value = roundAxis(output[lane]);
+                if ((config_.active & (1u << lane)) && value != controller.sentAxis[a]) {
+                    controller.sentAxis[a] = value;
+                    Sample& axis = axes[(*axisCount)++];
+                    axis = Sample();
+                    axis.kind = SAMPLE_AXIS;
+                    axis.controller = sample.controller;
+                    axis.code = a;
+                    axis.value = value;
+                    axis.hostTimeUs = sample.hostTimeUs;
+                }
+            }
+            return true;
+        }
+
+        case SAMPLE_GYRO:
+        case SAMPLE_ACCEL: {
+            int first = sample.kind == SAMPLE_GYRO ? 0 : 3;
+            memcpy(&controller.input[first], sample.data, 3 * sizeof(float));
+            run(controller, 7u << first, nominalDt_, output);
+            memcpy(sample.data, &output[first], 3 * sizeof(float));
+            return true;
+        }
+
+        case SAMPLE_AXIS: {
+            int lane = FilterConfig::AXIS_LANE + sample.code;
+            if (sample.code < 0 || sample.code >= FilterConfig::AXIS_LANES || !(config_.active & (1u << lane))) {
+                return true;
+            }
+            controller.input[lane] = (float)sample.value;
+            if (controller.imuSeen) {
+                return false; // sent from the next IMU sample
+            }
+            run(controller, 1u << lane, nominalDt_, output);
+            sample.value = controller.sentAxis[sample.code] = roundAxis(output[lane]);
+            return true;
+        }
+
+        default:
+            return true;
+    }
+}
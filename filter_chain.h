@@ -0,0 +1,122 @@
+#ifndef FILTER_CHAIN_H
+#define FILTER_CHAIN_H
+
+#include <stdint.h>
+#include "sample.h"
+
+// Smoothing of a controller's sensor and stick channels before they are sent.
+//
+// Every controller has LANES channels: gyro x, y, z and accel x, y, z (the
+// SAMPLE_IMU values), then the six SDL axes (sticks and triggers), then
+// padding. Each channel runs the same fixed chain of stages:
+//
+//   median of N  ->  deadzone with rescale  ->  low-pass  ->  high-pass  ->  one-euro
+//
+// and the configuration decides per channel which stages do something. A
+// stage that is off for a channel has identity coefficients, so the stages
+// run over all channels of a controller at once in struct-of-arrays form and
+// the loops vectorise across channels. Coefficients are computed once, by
+// FilterConfig::prepare(), for the nominal sample rate.
+//
+// Sticks and triggers only arrive when they change, which would leave a
+// smoothing filter stuck between two values. Once a controller delivers
+// SAMPLE_IMU, its filtered axes are therefore held and run with the sensor
+// channels at every IMU sample, and sent when their rounded output changes.
+// Without IMU samples, an axis is filtered when it arrives.
+
+enum FilterKind : uint8_t {
+    FILTER_MEDIAN,   // N: odd window of 3..MAX_MEDIAN samples
+    FILTER_DEADZONE, // threshold: a fraction of full scale for axes, m/s^2 or rad/s for the sensors
+    FILTER_LOWPASS,  // cutoff Hz [, Q]; second-order biquad
+    FILTER_HIGHPASS, // cutoff Hz [, Q]
+    FILTER_ONE_EURO, // min cutoff Hz [, beta [, derivative cutoff Hz]]; Casiez et al. 2012
+};
+
+// One filter for a set of channels, parsed from CHANNELS:KIND[:P1[:P2[:P3]]].
+// CHANNELS is a comma-separated list of gyro_x .. accel_z, left_x, left_y,
+// right_x, right_y, trigger_left, trigger_right or the groups gyro, accel,
+// imu, sticks, triggers and axes. KIND is median, deadzone, lowpass,
+// highpass or one_euro.
+struct FilterSpec {
+    uint32_t channels; // bit per lane
+    FilterKind kind;
+    float params[3];
+    int paramCount;
+};
+
+bool parseFilterSpec(const char* spec, FilterSpec* filter);
+
+// Coefficients of every stage for every lane
+struct FilterConfig {
+    static const int LANES = 16;
+    static const int IMU_LANES = 6;
+    static const int AXIS_LANE = 6; // first SDL axis
+    static const int AXIS_LANES = 6;
+    static const int MAX_MEDIAN = 9;
+
+    FilterConfig();
+
+    // Apply a filter to its channels; a later filter of the same kind replaces an earlier one
+    void add(const FilterSpec& filter);
+
+    // Compute the coefficients for sampleRateHz. False if a cutoff is not below half of it.
+    bool prepare(double sampleRateHz);
+
+    uint32_t active = 0; // lanes with any stage switched on
+    bool hasMedian = false;
+    bool hasEuro = false;
+
+    FilterSpec specs[5][LANES]; // per kind and lane, as configured (paramCount 0 = off)
+
+    alignas(64) float deadzone[LANES];
+    alignas(64) float deadzoneGain[LANES];
+    alignas(64) float b0[2][LANES]; // section 0 low-pass, 1 high-pass; transposed direct form II
+    alignas(64) float b1[2][LANES];
+    alignas(64) float b2[2][LANES];
+    alignas(64) float a1[2][LANES];
+    alignas(64) float a2[2][LANES];
+    alignas(64) float euroOn[LANES]; // 1 or 0
+    alignas(64) float euroMinCutoff[LANES];
+    alignas(64) float euroBeta[LANES];
+    alignas(64) float euroDerivativeTau[LANES]; // 1 / (2 pi derivative cutoff)
+    int median[LANES];                          // window, 1 = off
+};
+
+// Filter state of every controller
+class FilterBank {
+public:
+    static const int MAX_CONTROLLERS = 8;
+    static const int LANES = FilterConfig::LANES;
+
+    FilterBank(const FilterConfig& config, double sampleRateHz);
+
+    // Filter a sample in place; false if it is held instead of sent (a
+    // filtered axis of a controller with IMU samples). After a SAMPLE_IMU,
+    // axes holds the filtered axes whose rounded value changed.
+    bool process(Sample& sample, Sample* axes, int* axisCount);
+
+private:
+    struct Controller {
+        alignas(64) float input[LANES];
+        alignas(64) float z1[2][LANES];
+        alignas(64) float z2[2][LANES];
+        alignas(64) float euroX[LANES];
+        alignas(64) float euroDx[LANES];
+        float medianWindow[FilterConfig::MAX_MEDIAN][LANES];
+        uint8_t medianNext[LANES];
+        uint8_t medianFill[LANES];
+        int32_t sentAxis[FilterConfig::AXIS_LANES];
+        uint32_t started; // lanes whose state was initialised
+        bool imuSeen;
+        uint64_t lastImuUs;
+    };
+
+    void run(Controller& controller, uint32_t lanes, float dt, float* output);
+    void start(Controller& controller, uint32_t lanes, const float* x);
+
+    const FilterConfig& config_;
+    float nominalDt_;
+    Controller controllers_[MAX_CONTROLLERS];
+};
+
+#endif // FILTER_CHAIN_H
@@ -0,0 +1,188 @@
+#include "gesture_detector.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+static const float GRAVITY = 9.80665f;
+static const float DEGREES = 57.2957795f;
+
+// The largest of the first axes components of v as 1, 2 or 3, negative when it points the negative way
+static int32_t signedAxis(const float* v, int axes) {
+    int axis = 0;
+    for (int i = 1; i < axes; ++i) {
+        axis = fabsf(v[i]) > fabsf(v[axis]) ? i : axis;
+    }
+    return v[axis] < 0.0f ? -(axis + 1) : axis + 1;
+}
+
+static void emit(Gesture* gestures, int& count, GestureKind kind, const Sample& sample, float intensity,
+                 int32_t direction) {
+    Gesture& gesture = gestures[count++];
+    gesture.kind = kind;
+    gesture.controller = sample.controller;
+    gesture.intensity = intensity;
+    gesture.direction = direction;
+    gesture.hostTimeUs = sample.hostTimeUs;
+}
+
+GestureDetector::GestureDetector() {
+    memset(controllers_, 0, sizeof(controllers_));
+}
+
+int GestureDetector::update(Controller& controller, const float* gyro, uint64_t timeUs, const Sample& sample,
+                            Gesture* gestures) {
+    uint64_t step = timeUs - controller.lastUs;
+    bool restart = controller.lastUs == 0 || timeUs <= controller.lastUs || step > MAX_STEP_US;
+    if (restart) {
+        // Start over from this sample, taking its acceleration as gravity
+        float accel[3];
+        memcpy(accel, controller.accel, sizeof(accel));
+        memset(&controller, 0, offsetof(Controller, window));
+        controller.window.clear();
+        memcpy(controller.accel, accel, sizeof(accel));
+        memcpy(controller.gravity, accel, sizeof(accel));
+        controller.lastUs = timeUs;
+        return 0;
+    }
+    controller.lastUs = timeUs;
+    float dt = (float)step * 1e-6f;
+
+    // Movement acceleration: what gravity does not explain
+    float move[3];
+    float alpha = dt / (GRAVITY_TAU + dt);
+    for (int i = 0; i < 3; ++i) {
+        move[i] = controller.accel[i] - controller.gravity[i];
+        controller.gravity[i] += alpha * move[i];
+    }
+    float moveMagnitude = sqrtf(move[0] * move[0] + move[1] * move[1] + move[2] * move[2]);
+
+    // Whether the window before this sample was still, then the window with it
+    WindowedSum<WINDOW_CHANNELS, HISTORY>& window = controller.window;
+    double energyBefore = window.sum(WINDOW_ENERGY) + window.sum(WINDOW_ENERGY + 1) + window.sum(WINDOW_ENERGY + 2);
+    double quietLimit = (double)(TAP_QUIET_G * GRAVITY) * (TAP_QUIET_G * GRAVITY);
+    bool stillBefore = window.sum(WINDOW_DT) >= WINDOW_US * 0.5e-6 && energyBefore < quietLimit * window.sum(WINDOW_DT);
+
+    // Drop what left the window; a full ring drops its oldest entry itself
+    while (window.count() > 0 && window.oldestTimeUs() + WINDOW_US <= timeUs) {
+        window.dropOldest();
+    }
+    float entry[WINDOW_CHANNELS];
+    entry[WINDOW_DT] = dt;
+    for (int i = 0; i < 3; ++i) {
+        entry[WINDOW_ENERGY + i] = move[i] * move[i] * dt;
+    }
+    entry[WINDOW_ROLL] = gyro[2] * dt;
+    window.push(entry, timeUs);
+
+    double dtSum = window.sum(WINDOW_DT);
+    double energy = window.sum(WINDOW_ENERGY) + window.sum(WINDOW_ENERGY + 1) + window.sum(WINDOW_ENERGY + 2);
+    float rms = dtSum > 0.0 && energy > 0.0 ? (float)sqrt(energy / dtSum) : 0.0f;
+    int count = 0;
+
+    // Shake: count the reversals of the main movement axis
+    int axis = 0;
+    for (int i = 1; i < 3; ++i) {
+        axis = window.sum(WINDOW_ENERGY + i) > window.sum(WINDOW_ENERGY + axis) ? i : axis;
+    }
+    if (fabsf(move[axis]) > SHAKE_PEAK_G * GRAVITY) {
+        int sign = move[axis] > 0.0f ? 1 : -1;
+        if (controller.peakSign != 0 && sign != controller.peakSign) {
+            controller.reversals[controller.reversalNext] = timeUs;
+            controller.reversalNext = (controller.reversalNext + 1) % MAX_REVERSALS;
+        }
+        controller.peakSign = sign;
+    }
+    int reversals = 0;
+    for (uint64_t reversalUs : controller.reversals) {
+        reversals += reversalUs != 0 && timeUs - reversalUs <= SHAKE_WINDOW_US ? 1 : 0;
+    }
+    if (!controller.shaking && rms > SHAKE_G * GRAVITY && reversals >= SHAKE_REVERSALS) {
+        controller.shaking = true;
+        controller.tapping = false;
+        controller.flicking = false;
+        emit(gestures, count, GESTURE_SHAKE, sample, rms / GRAVITY, axis + 1);
+    } else if (controller.shaking && rms < 0.5f * SHAKE_G * GRAVITY) {
+        controller.shaking = false;
+        controller.tapQuietUs = controller.flickQuietUs = timeUs + REFRACTORY_US;
+    }
+    if (controller.shaking) {
+        return count;
+    }
+
+    // Tap: a short jolt out of stillness, without much rotation
+    float rate = sqrtf(gyro[0] * gyro[0] + gyro[1] * gyro[1]);
+    if (!controller.tapping && moveMagnitude > TAP_G * GRAVITY && stillBefore && timeUs >= controller.tapQuietUs) {
+        controller.tapping = true;
+        controller.tapStartUs = timeUs;
+        controller.tapPeak = 0.0f;
+    }
+    if (controller.tapping) {
+        if (moveMagnitude > controller.tapPeak) {
+            controller.tapPeak = moveMagnitude;
+            controller.tapDirection = signedAxis(move, 3);
+        }
+        if (timeUs - controller.tapStartUs > TAP_MAX_US || rate > FLICK_RATE) {
+            controller.tapping = false; // a movement, not a knock
+            controller.tapQuietUs = timeUs + REFRACTORY_US;
+        } else if (moveMagnitude < 0.5f * TAP_G * GRAVITY) {
+            controller.tapping = false;
+            controller.tapQuietUs = timeUs + REFRACTORY_US;
+            emit(gestures, count, GESTURE_TAP, sample, controller.tapPeak / GRAVITY, controller.tapDirection);
+        }
+    }
+
+    // Flick: a burst of rotation about x or y that stops again
+    if (!controller.flicking && rate > FLICK_RATE && timeUs >= controller.flickQuietUs) {
+        controller.flicking = true;
+        controller.flickStartUs = timeUs;
+        controller.flickPeak = 0.0f;
+        memset(controller.flickAngle, 0, sizeof(controller.flickAngle));
+    }
+    if (controller.flicking) {
+        controller.flickPeak = rate > controller.flickPeak ? rate : controller.flickPeak;
+        for (int i = 0; i < 3; ++i) {
+            controller.flickAngle[i] += gyro[i] * dt;
+        }
+        if (timeUs - controller.flickStartUs > FLICK_MAX_US) {
+            controller.flicking = false; // a sustained turn
+            controller.flickQuietUs = timeUs + REFRACTORY_US;
+        } else if (rate < 0.5f * FLICK_RATE) {
+            controller.flicking = false;
+            controller.flickQuietUs = timeUs + REFRACTORY_US;
+            emit(gestures, count, GESTURE_FLICK, sample, controller.flickPeak * DEGREES,
+                 signedAxis(controller.flickAngle, 2));
+        }
+    }
+
+    // Twist: enough rotation about z within the window
+    float roll = (float)window.sum(WINDOW_ROLL);
+    if (!controller.twisted && fabsf(roll) > TWIST_ANGLE) {
+        controller.twisted = true;
+        emit(gestures, count, GESTURE_TWIST, sample, fabsf(roll) * DEGREES, roll < 0.0f ? -3 : 3);
+    } else if (controller.twisted && fabsf(roll) < 0.5f * TWIST_ANGLE) {
+        controller.twisted = false;
+    }
+    return count;
+}
+
+int GestureDetector::add(const Sample& sample, Gesture* gestures) {
+    if (sample.controller < 0 || sample.controller >= MAX_CONTROLLERS) {
+        return 0;
+    }
+    Controller& controller = controllers_[sample.controller];
+    uint64_t timeUs = sample.timestampUs != 0 ? sample.timestampUs : sample.hostTimeUs;
+
+    switch (sample.kind) {
+        case SAMPLE_IMU:
+            memcpy(controller.accel, &sample.data[3], sizeof(controller.accel));
+            return update(controller, &sample.data[0], timeUs, sample, gestures);
+        case SAMPLE_GYRO:
+            return update(controller, sample.data, timeUs, sample, gestures);
+        case SAMPLE_ACCEL:
+            memcpy(controller.accel, sample.data, sizeof(controller.accel));
+            return 0;
+        default:
+            return 0;
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef GESTURE_DETECTOR_H
+#define GESTURE_DETECTOR_H
+
+#include <stdint.h>
+#include "sample.h"
+#include "windowed_sum.h"
+
+enum GestureKind : uint8_t {
+    GESTURE_SHAKE, // intensity: RMS movement acceleration over the window in g; direction: its main axis, unsigned
+    GESTURE_TAP,   // intensity: peak acceleration of the knock in g; direction: the way the controller was pushed
+    GESTURE_FLICK, // intensity: peak rotation rate in degrees/s; direction: the axis turned about, x or y
+    GESTURE_TWIST, // intensity: rotation about z over the window in degrees; direction: 3 or -3
+};
+
+static const int GESTURE_KINDS = 4;
+
+// A recognised gesture. Axes are those of the SDL sensor frame (x right, y up,
+// z towards the player) as 1, 2 or 3, negative for the negative direction.
+struct Gesture {
+    GestureKind kind;
+    int32_t controller;
+    float intensity;
+    int32_t direction;
+    uint64_t hostTimeUs; // of the sample that completed the gesture
+};
+
+// Recognises shake, tap, flick and twist gestures in the IMU stream of every
+// controller, one sample at a time.
+//
+// Gravity is tracked by a slow low-pass of the accelerometer; what is left is
+// the movement acceleration. The last WINDOW_US (at most HISTORY samples) of
+// per-axis movement energy and of the rotation about z are kept in a
+// WindowedSum, so each window feature costs an add and a subtract per sample.
+// The rest are small state machines:
+//
+// - shake: the movement RMS is above SHAKE_G and its main axis reversed
+//   direction at least SHAKE_REVERSALS times in SHAKE_WINDOW_US. Sent once;
+//   re-armed when the RMS drops below half.
+// - tap: the movement jumps above TAP_G out of a still window (RMS below
+//   TAP_QUIET_G) and is gone within TAP_MAX_US.
+// - flick: the rotation rate about x or y exceeds FLICK_RATE and drops below
+//   half of it within FLICK_MAX_US.
+// - twist: the rotation about z over the window exceeds TWIST_ANGLE.
+//   Re-armed when it drops below half.
+//
+// While a controller shakes, the other gestures are not reported.
+class GestureDetector {
+public:
+    static const int MAX_CONTROLLERS = 8;
+    static const int HISTORY = 256;
+    static const uint64_t WINDOW_US = 300000;
+    static const uint64_t MAX_STEP_US = 100000; // longer gaps restart the detection
+
+    static constexpr float GRAVITY_TAU = 0.25f; // s
+    static constexpr float SHAKE_G = 1.0f;
+    static constexpr float SHAKE_PEAK_G = 1.0f;  // a reversal counts from this acceleration on
+    static const int SHAKE_REVERSALS = 3;
+    static const uint64_t SHAKE_WINDOW_US = 600000;
+    static constexpr float TAP_G = 1.5f;
+    static constexpr float TAP_QUIET_G = 0.25f;
+    static const uint64_t TAP_MAX_US = 60000;
+    static constexpr float FLICK_RATE = 5.0f; // rad/s
+    static const uint64_t FLICK_MAX_US = 250000;
+    static constexpr float TWIST_ANGLE = 1.05f; // rad
+    static const uint64_t REFRACTORY_US = 200000; // after a tap or flick
+
+    GestureDetector();
+
+    // Feed one sample; returns how many gestures (at most GESTURE_KINDS) it
+    // completed, written to gestures. Backends that deliver gyro and accel
+    // separately are run on every gyro sample with the latest accel.
+    int add(const Sample& sample, Gesture* gestures);
+
+private:
+    static const int MAX_REVERSALS = 8;
+
+    // Channels of the window
+    enum {
+        WINDOW_DT,                       // s
+        WINDOW_ENERGY,                   // 3 channels: movement acceleration squared times dt, per axis
+        WINDOW_ROLL = WINDOW_ENERGY + 3, // rotation about z during dt
+        WINDOW_CHANNELS
+    };
+
+    struct Controller {
+        float accel[3]; // latest, for split gyro and accel samples
+        float gravity[3];
+        uint64_t lastUs; // 0 while (re)starting
+
+        uint64_t reversals[MAX_REVERSALS]; // times of the last reversals of the shake axis
+        int reversalNext;
+        int peakSign; // sign of the last peak on the shake axis
+        bool shaking;
+
+        bool tapping;
+        uint64_t tapStartUs;
+        float tapPeak;
+        int32_t tapDirection;
+        uint64_t tapQuietUs; // no tap before this
+
+        bool flicking;
+        uint64_t flickStartUs;
+        float flickPeak;
+        float flickAngle[3];
+        uint64_t flickQuietUs;
+
+        bool twisted;
+
+        WindowedSum<WINDOW_CHANNELS, HISTORY> window; // last, so a restart only clears what is before it
+    };
+
+    int update(Controller& controller, const float* gyro, uint64_t timeUs, const Sample& sample, Gesture* gestures);
+
+    Controller controllers_[MAX_CONTROLLERS];
+};
+
+#endif // GESTURE_DETECTOR_H
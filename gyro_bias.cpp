@@ -0,0 +1,107 @@
+#include "gyro_bias.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "controller_cache.h"
+
+static const char CACHE_HEADER[] = "ps5_kontroller gyro bias 1";
+
+void GyroBiasEstimator::setBias(const float* bias) {
+    for (int i = 0; i < 3; ++i) {
+        bias_[i] = bias ? bias[i] : 0.0f;
+    }
+    stillSamples_ = 0;
+    resetWindow();
+}
+
+void GyroBiasEstimator::resetWindow() {
+    window_.clear();
+    if (still_) {
+        still_ = false;
+        stillChanged_ = true;
+    }
+}
+
+// Variances scaled by WINDOW^2 (n * sum of squares - sum^2), so no division per sample
+bool GyroBiasEstimator::detectStill() const {
+    if (!window_.full()) {
+        return false;
+    }
+    const double n = WINDOW;
+    double sum[6];
+    double gyroSpread = 0.0;
+    double accelSpread = 0.0;
+    for (int i = 0; i < 6; ++i) {
+        sum[i] = window_.sum(i);
+    }
+    for (int i = 0; i < 3; ++i) {
+        gyroSpread += n * window_.sum(6 + i) - sum[i] * sum[i];
+        accelSpread += n * window_.sum(9 + i) - sum[3 + i] * sum[3 + i];
+    }
+    bool slow = sum[0] * sum[0] < MAX_BIAS * MAX_BIAS * n * n && sum[1] * sum[1] < MAX_BIAS * MAX_BIAS * n * n &&
+                sum[2] * sum[2] < MAX_BIAS * MAX_BIAS * n * n;
+    return slow && gyroSpread < GYRO_VARIANCE_STILL * n * n && accelSpread < ACCEL_VARIANCE_STILL * n * n;
+}
+
+void GyroBiasEstimator::process(float* imu) {
+    float entry[12];
+    for (int i = 0; i < 6; ++i) {
+        entry[i] = imu[i];
+        entry[6 + i] = imu[i] * imu[i];
+    }
+    window_.push(entry);
+
+    bool still = detectStill();
+    if (still != still_) {
+        still_ = still;
+        stillChanged_ = true;
+    }
+    if (still) {
+        stillSamples_++;
+        for (int i = 0; i < 3; ++i) {
+            bias_[i] += LEARNING_RATE * (imu[i] - bias_[i]);
+        }
+    }
+
+    imu[0] -= bias_[0];
+    imu[1] -= bias_[1];
+    imu[2] -= bias_[2];
+}
+
+bool loadGyroBias(const char* kind, const char* serial, float* bias) {
+    char path[600];
+    if (!controllerCachePath(kind, serial, path, sizeof(path))) {
+        return false;
+    }
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    char header[64] = {0};
+    float v[3];
+    bool ok = fgets(header, sizeof(header), file) && strncmp(header, CACHE_HEADER, sizeof(CACHE_HEADER) - 1) == 0 &&
+              fscanf(file, " gyro_bias %f %f %f", &v[0], &v[1], &v[2]) == 3;
+    fclose(file);
+    for (int i = 0; ok && i < 3; ++i) {
+        ok = v[i] >= -GyroBiasEstimator::MAX_BIAS && v[i] <= GyroBiasEstimator::MAX_BIAS;
+    }
+    if (!ok) {
+        return false;
+    }
+    memcpy(bias, v, sizeof(v));
+    return true;
+}
+
+bool saveGyroBias(const char* kind, const char* serial, const float* bias) {
+    char path[600];
+    if (!controllerCachePath(kind, serial, path, sizeof(path))) {
+        return false;
+    }
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "%s\n", CACHE_HEADER);
+    fprintf(file, "gyro_bias %.9g %.9g %.9g\n", bias[0], bias[1], bias[2]);
+    return fclose(file) == 0;
+}
@@ -0,0 +1,65 @@
+#ifndef GYRO_BIAS_H
+#define GYRO_BIAS_H
+
+#include <stdint.h>
+#include "windowed_sum.h"
+
+// Learns the gyro zero offset of one controller while it lies still and
+// removes it from every sample.
+//
+// The last WINDOW samples of gyro and accel and their squares are kept in a
+// WindowedSum, so the rolling variance costs a few additions per sample. The controller counts as still while the window is
+// full, both variances are below their thresholds and the mean rotation is
+// small enough to be bias rather than a slow turn. While still, each sample
+// moves the bias a LEARNING_RATE step towards its reading.
+class GyroBiasEstimator {
+public:
+    static const int WINDOW = 64;                           // samples, about 0.25 s at 250 Hz
+    static constexpr float GYRO_VARIANCE_STILL = 2e-4f;     // (rad/s)^2, about 0.8 deg/s standard deviation
+    static constexpr float ACCEL_VARIANCE_STILL = 1e-2f;    // (m/s^2)^2
+    static constexpr float MAX_BIAS = 0.1f;                 // rad/s; a steadier rotation is a turn
+    static constexpr float LEARNING_RATE = 0.02f;           // per still sample
+    static const uint32_t LEARNED_SAMPLES = 250;            // still samples before the bias is worth keeping
+
+    GyroBiasEstimator() { setBias(nullptr); }
+
+    // imu = gyro x, y, z (rad/s), accel x, y, z (m/s^2); the bias is subtracted from the gyro in place
+    void process(float* imu);
+
+    // Start over with a known bias (nullptr for zero); the window is emptied
+    void setBias(const float* bias);
+
+    // Empty the window but keep the bias, e.g. for a reconnect
+    void resetWindow();
+
+    const float* bias() const { return bias_; }
+    bool still() const { return still_; }
+
+    // True once after the controller became still or started moving
+    bool takeStillnessChange() {
+        bool changed = stillChanged_;
+        stillChanged_ = false;
+        return changed;
+    }
+
+    // Enough still samples seen since setBias() to store the bias
+    bool learned() const { return stillSamples_ >= LEARNED_SAMPLES; }
+
+private:
+    bool detectStill() const;
+
+    WindowedSum<12, WINDOW> window_; // gyro and accel x, y, z, then their squares
+
+    float bias_[3];
+    bool still_ = false;
+    bool stillChanged_ = false;
+    uint32_t stillSamples_ = 0;
+};
+
+// The bias stored for a controller serial (see controller_cache.h). kind
+// tells apart backends whose sensor scales differ, so their residual bias
+// differs too.
+bool loadGyroBias(const char* kind, const char* serial, float* bias);
+bool saveGyroBias(const char* kind, const char* serial, const float* bias);
+
+#endif // GYRO_BIAS_H
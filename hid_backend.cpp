@@ -0,0 +1,201 @@
+#include "hid_backend.h"
+
+#include <stdio.h>
+#include <wchar.h>
+
+static const char GYRO_BIAS_KIND[] = "gyro_bias";
+
+HidBackend::HidBackend(SampleSink& sink, bool newestOnly) : sink_(sink), newestOnly_(newestOnly) {}
+
+HidBackend::~HidBackend() {
+    close();
+}
+
+bool HidBackend::open() {
+    if (hid_init()) {
+        printf("Failed to initialize HIDAPI\n");
+        return false;
+    }
+
+    // Open the DualSense controller
+    device_ = hid_open(DS_VENDOR_ID, DS_PRODUCT_ID, NULL);
+    if (!device_) {
+        printf("Unable to open DualSense controller\n");
+        hid_exit();
+        return false;
+    }
+
+    // Get device info
+    wchar_t product[255] = {0};
+    wchar_t serial[255] = {0};
+    hid_get_product_string(device_, product, 255);
+    hid_get_serial_number_string(device_, serial, 255);
+    printf("Controller opened: %ls (serial %ls)\n", product, serial);
+    size_t n = 0;
+    for (; serial[n] && n + 1 < sizeof(serial_); ++n) {
+        serial_[n] = serial[n] < 0x80 ? (char)serial[n] : '-';
+    }
+    serial_[n] = '\0';
+
+    if (newestOnly_) {
+        printf("HID reads keep only the newest queued report\n");
+    }
+
+    decoder_.reset();
+    featureRead_ = false;
+    loadCalibration();
+    float bias[3];
+    if (loadGyroBias(GYRO_BIAS_KIND, serial_, bias)) {
+        decoder_.gyroBias().setBias(bias);
+        printf("Gyro bias cached: %.4f %.4f %.4f rad/s\n", bias[0], bias[1], bias[2]);
+    }
+    if (DsOutputScheduler* output = sink_.output ? sink_.output->forController(decoder_.controller()) : nullptr) {
+        output->reset();
+    }
+    return true;
+}
+
+// Reading feature report 0x05 also switches a Bluetooth controller from short
+// reports to extended 0x31 reports with sensors
+bool HidBackend::readCalibration(DsCalibration* calibration) {
+    featureRead_ = true;
+    uint8_t feature[DS_FEATURE_REPORT_CALIBRATION_SIZE] = {DS_FEATURE_REPORT_CALIBRATION};
+    int length = hid_get_feature_report(device_, feature, sizeof(feature));
+    if (length < 0) {
+        printf("Could not read the calibration report: %ls\n", hid_error(device_));
+        return false;
+    }
+    return dsParseCalibration(feature, length, calibration);
+}
+
+// A calibration cached for this serial saves the feature report round trip on reconnect
+void HidBackend::loadCalibration() {
+    DsCalibration calibration;
+    const char* source = "cached";
+    if (!dsLoadCalibration(serial_, &calibration)) {
+        if (!readCalibration(&calibration)) {
+            printf("Using the nominal sensor scale\n");
+            return;
+        }
+        source = "read from the controller";
+        dsSaveCalibration(serial_, calibration);
+    }
+    int invalidAxes = 0;
+    decoder_.setCalibration(dsCalibrationScale(calibration, &invalidAxes));
+    printf("Sensor calibration %s", source);
+    if (invalidAxes > 0) {
+        printf(", %d implausible axes kept the nominal scale", invalidAxes);
+    }
+    printf("\n");
+}
+
+void HidBackend::close() {
+    if (device_) {
+        // The next start begins with what was learned this time
+        if (decoder_.gyroBias().learned()) {
+            saveGyroBias(GYRO_BIAS_KIND, serial_, decoder_.gyroBias().bias());
+        }
+        hid_close(device_);
+        device_ = nullptr;
+        hid_exit();
+    }
+}
+
+bool HidBackend::pump(int timeoutMs) {
+    // Block for the first report, then take everything already queued without waiting,
+    // so a wakeup never leaves older reports behind in the OS buffer
+    uint8_t data[2][MAX_REPORT_SIZE];
+    int current = 0;
+    int res = hid_read_timeout(device_, data[current], MAX_REPORT_SIZE, timeoutMs);
+    unsigned depth = 0;
+    while (res > 0) {
+        uint64_t arrivalUs = hostMonotonicUs();
+        depth++;
+        if (!newestOnly_) {
+            decodeReport(data[current], res, arrivalUs);
+        }
+
+        int next = hid_read_timeout(device_, data[current ^ 1], MAX_REPORT_SIZE, 0);
+        if (next <= 0 && newestOnly_) {
+            // The last report of this wakeup, also when the drain read failed
+            decodeReport(data[current], res, arrivalUs);
+        } else if (next > 0 && newestOnly_) {
+            decoder_.skip(data[current], res);
+            superseded_++;
+        }
+        current ^= 1;
+        res = next;
+    }
+    if (depth > 0) {
+        recordBacklog(depth);
+        writeOutput();
+    }
+    if (res < 0) {
+        printf("Controller read failed: %ls\n", hid_error(device_));
+        return false;
+    }
+    return true;
+}
+
+void HidBackend::recordBacklog(unsigned depth) {
+    wakeups_++;
+    backlogTotal_ += depth;
+    backlogMax_ = depth > backlogMax_ ? depth : backlogMax_;
+    intervalWakeups_++;
+    intervalBacklogTotal_ += depth;
+    intervalBacklogMax_ = depth > intervalBacklogMax_ ? depth : intervalBacklogMax_;
+}
+
+void HidBackend::decodeReport(const uint8_t* data, int length, uint64_t arrivalUs) {
+    Sample sample;
+    if (decoder_.decode(data, length, arrivalUs, &sample)) {
+        sink_.emit(sample, 2);
+        if (decoder_.gyroBias().takeStillnessChange()) {
+            sink_.reportGyroBias(decoder_.controller(), decoder_.gyroBias());
+        }
+    } else if (decoder_.shortReports() && !featureRead_) {
+        // The calibration came from the cache, but the controller still needs the request
+        DsCalibration unused;
+        readCalibration(&unused);
+    }
+    if (decoder_.delta().fields != 0) {
+        sink_.emitStateChanges(decoder_.controller(), decoder_.state(), decoder_.delta(), decoder_.stateTimeUs());
+    }
+}
+
+// The report format follows the transport, known from the first decoded report
+void HidBackend::writeOutput() {
+    DsOutputScheduler* output = sink_.output ? sink_.output->forController(decoder_.controller()) : nullptr;
+    if (!output || decoder_.usbReports() + decoder_.bluetoothReports() == 0) {
+        return;
+    }
+    uint8_t report[DS_OUTPUT_REPORT_BT_SIZE];
+    int length = output->nextReport(hostMonotonicUs(), decoder_.bluetooth(), report);
+    if (length > 0 && hid_write(device_, report, length) < 0 && outputErrors_++ == 0) {
+        printf("Controller write failed: %ls\n", hid_error(device_));
+    }
+}
+
+void HidBackend::checkStatus() {
+    if (intervalWakeups_ > 0) {
+        printf("HID backlog: %.2f reports per wakeup, max %u\n",
+               (double)intervalBacklogTotal_ / intervalWakeups_, intervalBacklogMax_);
+        intervalWakeups_ = 0;
+        intervalBacklogTotal_ = 0;
+        intervalBacklogMax_ = 0;
+    }
+    decoder_.reportCrcFailures("HID");
+    sink_.reportLoss("HID", decoder_.controller(), decoder_.loss());
+    sink_.reportGyroBias(decoder_.controller(), decoder_.gyroBias());
+}
+
+void HidBackend::printStats() const {
+    decoder_.printStats("HID");
+    if (wakeups_ > 0) {
+        printf("HID backlog: %.2f reports per wakeup, max %u, %llu superseded\n",
+               (double)backlogTotal_ / wakeups_, backlogMax_, (unsigned long long)superseded_);
+    }
+    if (outputErrors_ > 0) {
+        printf("HID: %llu output reports failed\n", (unsigned long long)outputErrors_);
+    }
+}
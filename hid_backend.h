@@ -0,0 +1,68 @@
+#ifndef HID_BACKEND_H
+#define HID_BACKEND_H
+
+#include <hidapi/hidapi.h>
+#include <stdint.h>
+#include "dualsense.h"
+#include "dualsense_decoder.h"
+#include "input_backend.h"
+
+// Input straight from the DualSense's HID reports through hidapi.
+//
+// No SDL at all: no joystick subsystem, event queue or mapping layer between
+// the read and the sink. Each input report becomes one SAMPLE_IMU (see
+// DualSenseDecoder).
+//
+// Every wakeup drains all reports queued in the OS; with newestOnly only the
+// last of them is decoded, trading intermediate samples for the freshest one.
+// The skipped reports still count as received in the loss statistics.
+// The number of reports per wakeup is the backlog metric: 1 means the reader
+// keeps up with the controller.
+//
+// Pending rumble, light and trigger settings are written after each wakeup,
+// at most one output report per wakeup (see DsOutputScheduler).
+//
+// The sensor calibration is read once per controller and cached by serial
+// number (see dualsense_calibration.h); the gyro bias learned while the
+// controller lies still is stored the same way on close.
+class HidBackend : public InputBackend {
+public:
+    HidBackend(SampleSink& sink, bool newestOnly);
+    ~HidBackend() override;
+
+    const char* name() const override { return "hid"; }
+    bool open() override;
+    bool pump(int timeoutMs) override;
+    void checkStatus() override;
+    void printStats() const override;
+    void close() override;
+
+private:
+    static const int MAX_REPORT_SIZE = DS_INPUT_REPORT_BT_SIZE;
+
+    bool readCalibration(DsCalibration* calibration);
+    void loadCalibration();
+    void decodeReport(const uint8_t* data, int length, uint64_t arrivalUs);
+    void writeOutput();
+    void recordBacklog(unsigned depth);
+
+    SampleSink& sink_;
+    bool newestOnly_;
+    hid_device* device_ = nullptr;
+    DualSenseDecoder decoder_;
+    char serial_[64] = {0};
+    bool featureRead_ = false; // the calibration report was requested since open()
+
+    uint64_t superseded_ = 0; // skipped in favour of a newer report
+    uint64_t outputErrors_ = 0;
+
+    // Reports drained per wakeup, overall and since the last status check
+    uint64_t wakeups_ = 0;
+    uint64_t backlogTotal_ = 0;
+    unsigned backlogMax_ = 0;
+    uint64_t intervalWakeups_ = 0;
+    uint64_t intervalBacklogTotal_ = 0;
+    unsigned intervalBacklogMax_ = 0;
+};
+
+#endif // HID_BACKEND_H
@@ -0,0 +1,540 @@
+#include "hidraw_backend.h"
+
+#ifdef __linux__
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/hidraw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <thread>
+
+static const char GYRO_BIAS_KIND[] = "gyro_bias";
+
+HidrawBackend::HidrawBackend(SampleSink& sink, const Options& options) : sink_(sink), options_(options) {}
+
+HidrawBackend::~HidrawBackend() {
+    close();
+}
+
+bool HidrawBackend::open() {
+    if (options_.useIoUring) {
+#ifdef PS5_HAVE_LIBURING
+        if (options_.replaySource) {
+            printf("hidraw: replay does not use io_uring\n");
+        } else {
+            int rc = io_uring_queue_init(MAX_DEVICES * 2, &ring_, 0);
+            if (rc < 0) {
+                printf("hidraw: io_uring unavailable (%s), using epoll\n", strerror(-rc));
+            } else {
+                useIoUring_ = true;
+            }
+        }
+#else
+        printf("hidraw: built without io_uring support (PS5_HAVE_LIBURING), using epoll\n");
+#endif
+    }
+    if (!useIoUring_) {
+        epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd_ < 0) {
+            printf("hidraw: epoll_create1 failed: %s\n", strerror(errno));
+            return false;
+        }
+    }
+
+    if (options_.recordPath) {
+        recordFd_ = ::open(options_.recordPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (recordFd_ < 0) {
+            printf("hidraw: cannot create recording %s: %s\n", options_.recordPath, strerror(errno));
+            close();
+            return false;
+        }
+        printf("Recording raw reports to %s\n", options_.recordPath);
+    }
+
+    if (options_.replaySource) {
+        openReplay(options_.replaySource);
+    } else {
+        discover();
+    }
+    if (activeDevices_ == 0) {
+        printf("No DualSense hidraw device found\n");
+        close();
+        return false;
+    }
+    printf("hidraw: %d controller(s), %s\n", activeDevices_, useIoUring_ ? "io_uring" : "epoll");
+    return true;
+}
+
+void HidrawBackend::close() {
+    for (int i = 0; i < deviceCount_; ++i) {
+        if (devices_[i].fd >= 0) {
+            storeGyroBias(devices_[i]);
+            ::close(devices_[i].fd);
+            devices_[i].fd = -1;
+        }
+    }
+    deviceCount_ = 0;
+    activeDevices_ = 0;
+    if (epollFd_ >= 0) {
+        ::close(epollFd_);
+        epollFd_ = -1;
+    }
+    if (recordFd_ >= 0) {
+        ::close(recordFd_);
+        recordFd_ = -1;
+    }
+#ifdef PS5_HAVE_LIBURING
+    if (useIoUring_) {
+        io_uring_queue_exit(&ring_);
+        useIoUring_ = false;
+    }
+#endif
+}
+
+// Open every DualSense hidraw node that is not open yet
+void HidrawBackend::discover() {
+    DIR* dir = opendir("/sys/class/hidraw");
+    if (!dir) {
+        return;
+    }
+    while (dirent* entry = readdir(dir)) {
+        if (strncmp(entry->d_name, "hidraw", 6) != 0) {
+            continue;
+        }
+        char ueventPath[300];
+        snprintf(ueventPath, sizeof(ueventPath), "/sys/class/hidraw/%s/device/uevent", entry->d_name);
+        FILE* uevent = fopen(ueventPath, "r");
+        if (!uevent) {
+            continue;
+        }
+        // HID_ID=<bus>:<vendor>:<product>, e.g. 0005:0000054C:00000CE6 over Bluetooth
+        char line[256];
+        unsigned bus = 0, vendor = 0, product = 0;
+        bool match = false;
+        while (fgets(line, sizeof(line), uevent)) {
+            if (sscanf(line, "HID_ID=%x:%x:%x", &bus, &vendor, &product) == 3) {
+                match = vendor == DS_VENDOR_ID && product == DS_PRODUCT_ID;
+                break;
+            }
+        }
+        fclose(uevent);
+
+        char path[64];
+        snprintf(path, sizeof(path), "/dev/%.32s", entry->d_name);
+        if (match && !isOpen(path)) {
+            openDevice(path);
+        }
+    }
+    closedir(dir);
+}
+
+bool HidrawBackend::isOpen(const char* path) const {
+    for (int i = 0; i < deviceCount_; ++i) {
+        if (devices_[i].fd >= 0 && strcmp(devices_[i].path, path) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Put fd into a free slot and start waiting on it; returns the slot or -1
+int HidrawBackend::addDevice(int fd, const char* path, bool replay) {
+    int slot = 0;
+    while (slot < deviceCount_ && devices_[slot].fd >= 0) {
+        slot++;
+    }
+    if (slot == MAX_DEVICES) {
+        printf("hidraw: more than %d controllers, ignoring %s\n", MAX_DEVICES, path);
+        return -1;
+    }
+
+    Device& device = devices_[slot];
+    device.fd = fd;
+    snprintf(device.path, sizeof(device.path), "%s", path);
+    device.serial[0] = '\0';
+    device.replay = replay;
+    device.featureRead = false;
+    device.pollable = true;
+    device.decoder = DualSenseDecoder(slot);
+    if (DsOutputScheduler* output = sink_.output ? sink_.output->forController(slot) : nullptr) {
+        output->reset();
+    }
+    device.replayFill = 0;
+
+    if (epollFd_ >= 0) {
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u32 = (uint32_t)slot;
+        if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            if (errno != EPERM || !replay) {
+                printf("hidraw: cannot wait on %s: %s\n", path, strerror(errno));
+                device.fd = -1;
+                return -1;
+            }
+            device.pollable = false; // a regular file, always readable
+        }
+    }
+
+    deviceCount_ = slot == deviceCount_ ? deviceCount_ + 1 : deviceCount_;
+    activeDevices_++;
+#ifdef PS5_HAVE_LIBURING
+    if (useIoUring_) {
+        postRead(slot);
+        io_uring_submit(&ring_);
+    }
+#endif
+    return slot;
+}
+
+bool HidrawBackend::openDevice(const char* path) {
+    // io_uring honours O_NONBLOCK by failing reads with EAGAIN, so only epoll uses it
+    int flags = O_RDWR | O_CLOEXEC | (useIoUring_ ? 0 : O_NONBLOCK);
+    int fd = ::open(path, flags);
+    if (fd < 0) {
+        printf("Could not open %s: %s%s\n", path, strerror(errno),
+               errno == EACCES ? " (check the udev permissions of hidraw devices)" : "");
+        return false;
+    }
+
+    int slot = addDevice(fd, path, false);
+    if (slot < 0) {
+        ::close(fd);
+        return false;
+    }
+    Device& device = devices_[slot];
+#ifdef HIDIOCGRAWUNIQ
+    if (ioctl(fd, HIDIOCGRAWUNIQ(sizeof(device.serial)), device.serial) < 0) {
+        device.serial[0] = '\0';
+    }
+#endif
+    if (device.serial[0]) {
+        printf("Controller opened: %s (serial %s)\n", path, device.serial);
+    } else {
+        printf("Controller opened: %s\n", path);
+    }
+    loadCalibration(device);
+    float bias[3];
+    if (loadGyroBias(GYRO_BIAS_KIND, device.serial, bias)) {
+        device.decoder.gyroBias().setBias(bias);
+        printf("%s: gyro bias cached: %.4f %.4f %.4f rad/s\n", path, bias[0], bias[1], bias[2]);
+    }
+    return true;
+}
+
+// The next start begins with what was learned this time
+void HidrawBackend::storeGyroBias(Device& device) {
+    GyroBiasEstimator& gyroBias = device.decoder.gyroBias();
+    if (!device.replay && gyroBias.learned()) {
+        saveGyroBias(GYRO_BIAS_KIND, device.serial, gyroBias.bias());
+    }
+}
+
+// Reading feature report 0x05 also switches a Bluetooth controller from short
+// reports to extended 0x31 reports with sensors
+bool HidrawBackend::readCalibration(Device& device, DsCalibration* calibration) {
+    device.featureRead = true;
+    uint8_t feature[DS_FEATURE_REPORT_CALIBRATION_SIZE] = {DS_FEATURE_REPORT_CALIBRATION};
+    int length = ioctl(device.fd, HIDIOCGFEATURE(sizeof(feature)), feature);
+    if (length < 0) {
+        printf("Could not read the calibration report of %s: %s\n", device.path, strerror(errno));
+        return false;
+    }
+    return dsParseCalibration(feature, length, calibration);
+}
+
+// A calibration cached for this controller saves the feature report round trip on reconnect
+void HidrawBackend::loadCalibration(Device& device) {
+    DsCalibration calibration;
+    const char* source = "cached";
+    if (!dsLoadCalibration(device.serial, &calibration)) {
+        if (!readCalibration(device, &calibration)) {
+            printf("%s: using the nominal sensor scale\n", device.path);
+            return;
+        }
+        source = "read from the controller";
+        dsSaveCalibration(device.serial, calibration);
+    }
+    int invalidAxes = 0;
+    device.decoder.setCalibration(dsCalibrationScale(calibration, &invalidAxes));
+    printf("%s: sensor calibration %s", device.path, source);
+    if (invalidAxes > 0) {
+        printf(", %d implausible axes kept the nominal scale", invalidAxes);
+    }
+    printf("\n");
+}
+
+bool HidrawBackend::openReplay(const char* source) {
+    int fd;
+    if (strcmp(source, "-") == 0) {
+        fd = dup(STDIN_FILENO);
+    } else if (strncmp(source, "fd:", 3) == 0) {
+        fd = dup(atoi(source + 3));
+    } else {
+        fd = ::open(source, O_RDONLY | O_CLOEXEC);
+    }
+    if (fd < 0) {
+        printf("Could not open replay source %s: %s\n", source, strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && !S_ISREG(st.st_mode)) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+    if (addDevice(fd, source, true) < 0) {
+        ::close(fd);
+        return false;
+    }
+    printf("Replaying reports from %s\n", source);
+    return true;
+}
+
+void HidrawBackend::removeDevice(Device& device, const char* reason) {
+    printf("Controller removed: %s (%s)\n", device.path, reason);
+    storeGyroBias(device);
+    ::close(device.fd); // also drops it from the epoll set
+    device.fd = -1;
+    activeDevices_--;
+}
+
+bool HidrawBackend::pump(int timeoutMs) {
+#ifdef PS5_HAVE_LIBURING
+    bool running = useIoUring_ ? pumpUring(timeoutMs) : pumpEpoll(timeoutMs);
+#else
+    bool running = pumpEpoll(timeoutMs);
+#endif
+
+    if (sink_.output) {
+        uint64_t now = hostMonotonicUs();
+        for (int i = 0; i < deviceCount_; ++i) {
+            writeOutput(devices_[i], now);
+        }
+    }
+    return running;
+}
+
+// The report format follows the transport, known from the first decoded report
+void HidrawBackend::writeOutput(Device& device, uint64_t nowUs) {
+    const DualSenseDecoder& decoder = device.decoder;
+    DsOutputScheduler* output = sink_.output->forController(decoder.controller());
+    if (device.fd < 0 || device.replay || !output || decoder.usbReports() + decoder.bluetoothReports() == 0) {
+        return;
+    }
+    uint8_t report[DS_OUTPUT_REPORT_BT_SIZE];
+    int length = output->nextReport(nowUs, decoder.bluetooth(), report);
+    if (length > 0 && write(device.fd, report, length) < 0) {
+        outputErrors_++;
+    }
+}
+
+bool HidrawBackend::replayHasRoom() const {
+    return sink_.ring->size() < sink_.ring->capacity() / 2;
+}
+
+bool HidrawBackend::pumpEpoll(int timeoutMs) {
+    // Replay waits for the transmit thread rather than overflowing the ring
+    bool replaying = options_.replaySource != nullptr;
+    if (replaying && !replayHasRoom()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return activeDevices_ > 0;
+    }
+
+    // Regular files never signal readiness; they always have data until EOF
+    for (int i = 0; i < deviceCount_; ++i) {
+        if (devices_[i].fd >= 0 && !devices_[i].pollable) {
+            readReplay(devices_[i]);
+            timeoutMs = 0;
+        }
+    }
+
+    epoll_event events[MAX_DEVICES];
+    int n = epoll_wait(epollFd_, events, MAX_DEVICES, timeoutMs);
+    if (n < 0 && errno != EINTR) {
+        printf("hidraw: epoll_wait failed: %s\n", strerror(errno));
+        return false;
+    }
+    if (n > 0) {
+        wakeups_++;
+    }
+    for (int i = 0; i < n; ++i) {
+        Device& device = devices_[events[i].data.u32];
+        if (device.fd < 0) {
+            continue;
+        }
+        // Errors and hangups surface through the read itself
+        if (device.replay) {
+            readReplay(device);
+        } else {
+            readDevice(device);
+        }
+    }
+    return activeDevices_ > 0;
+}
+
+// Read until the kernel queue of the device is empty; hidraw returns one report per read
+void HidrawBackend::readDevice(Device& device) {
+    uint8_t data[MAX_REPORT_SIZE];
+    for (;;) {
+        ssize_t n = read(device.fd, data, sizeof(data));
+        if (n > 0) {
+            reads_++;
+            handleReport(device, data, (int)n, hostMonotonicUs());
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && errno == EAGAIN) {
+            return;
+        } else {
+            removeDevice(device, n == 0 ? "closed" : strerror(errno));
+            return;
+        }
+    }
+}
+
+// Read the next chunk of a recording and decode every complete report in it
+void HidrawBackend::readReplay(Device& device) {
+    if (!replayHasRoom()) {
+        return;
+    }
+    ssize_t n = read(device.fd, device.replayBuffer + device.replayFill, REPLAY_BUFFER_SIZE - device.replayFill);
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EINTR) {
+            removeDevice(device, strerror(errno));
+        }
+        return;
+    }
+    if (n == 0) {
+        removeDevice(device, device.replayFill ? "truncated recording" : "end of recording");
+        return;
+    }
+    reads_++;
+    device.replayFill += (size_t)n;
+
+    uint64_t arrivalUs = hostMonotonicUs();
+    size_t pos = 0;
+    while (device.replayFill - pos >= 2) {
+        size_t length = device.replayBuffer[pos] | (device.replayBuffer[pos + 1] << 8);
+        if (length == 0 || length > MAX_REPORT_SIZE) {
+            removeDevice(device, "corrupt recording");
+            return;
+        }
+        if (device.replayFill - pos - 2 < length) {
+            break;
+        }
+        handleReport(device, device.replayBuffer + pos + 2, (int)length, arrivalUs);
+        pos += 2 + length;
+    }
+    memmove(device.replayBuffer, device.replayBuffer + pos, device.replayFill - pos);
+    device.replayFill -= pos;
+}
+
+void HidrawBackend::handleReport(Device& device, const uint8_t* data, int length, uint64_t arrivalUs) {
+    if (recordFd_ >= 0 && !device.replay) {
+        uint8_t header[2] = {(uint8_t)length, (uint8_t)(length >> 8)};
+        iovec parts[2] = {{header, sizeof(header)}, {(void*)data, (size_t)length}};
+        if (writev(recordFd_, parts, 2) < 0) {
+            printf("hidraw: recording failed: %s\n", strerror(errno));
+            ::close(recordFd_);
+            recordFd_ = -1;
+        }
+    }
+
+    Sample sample;
+    if (device.decoder.decode(data, length, arrivalUs, &sample)) {
+        sink_.emit(sample, 2);
+        if (device.decoder.gyroBias().takeStillnessChange()) {
+            sink_.reportGyroBias(device.decoder.controller(), device.decoder.gyroBias());
+        }
+    } else if (device.decoder.shortReports() && !device.featureRead && !device.replay) {
+        // The calibration came from the cache, but the controller still needs the request
+        DsCalibration unused;
+        readCalibration(device, &unused);
+    }
+    const DualSenseDecoder& decoder = device.decoder;
+    if (decoder.delta().fields != 0) {
+        sink_.emitStateChanges(decoder.controller(), decoder.state(), decoder.delta(), decoder.stateTimeUs());
+    }
+}
+
+#ifdef PS5_HAVE_LIBURING
+void HidrawBackend::postRead(int slot) {
+    io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+    if (!sqe) {
+        io_uring_submit(&ring_);
+        sqe = io_uring_get_sqe(&ring_);
+    }
+    io_uring_prep_read(sqe, devices_[slot].fd, devices_[slot].report, MAX_REPORT_SIZE, 0);
+    io_uring_sqe_set_data(sqe, (void*)(uintptr_t)slot);
+}
+
+bool HidrawBackend::pumpUring(int timeoutMs) {
+    io_uring_cqe* cqe;
+    __kernel_timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = (long long)(timeoutMs % 1000) * 1000000;
+    int rc = io_uring_wait_cqe_timeout(&ring_, &cqe, &timeout);
+    if (rc == -ETIME || rc == -EINTR) {
+        return activeDevices_ > 0;
+    }
+    if (rc < 0) {
+        printf("hidraw: io_uring wait failed: %s\n", strerror(-rc));
+        return false;
+    }
+    wakeups_++;
+
+    // Handle every completion, then repost the reads in one submit
+    uint64_t arrivalUs = hostMonotonicUs();
+    unsigned head;
+    unsigned completed = 0;
+    io_uring_for_each_cqe(&ring_, head, cqe) {
+        int slot = (int)(uintptr_t)io_uring_cqe_get_data(cqe);
+        Device& device = devices_[slot];
+        completed++;
+        if (device.fd < 0) {
+            continue;
+        }
+        if (cqe->res > 0) {
+            reads_++;
+            handleReport(device, device.report, cqe->res, arrivalUs);
+            postRead(slot);
+        } else if (cqe->res == -EINTR || cqe->res == -EAGAIN) {
+            postRead(slot);
+        } else {
+            removeDevice(device, cqe->res == 0 ? "closed" : strerror(-cqe->res));
+        }
+    }
+    io_uring_cq_advance(&ring_, completed);
+    io_uring_submit(&ring_);
+    return activeDevices_ > 0;
+}
+#endif
+
+void HidrawBackend::checkStatus() {
+    if (!options_.replaySource) {
+        discover();
+    }
+    for (int i = 0; i < deviceCount_; ++i) {
+        if (devices_[i].fd >= 0) {
+            devices_[i].decoder.reportCrcFailures(devices_[i].path);
+            sink_.reportLoss(devices_[i].path, i, devices_[i].decoder.loss());
+            sink_.reportGyroBias(i, devices_[i].decoder.gyroBias());
+        }
+    }
+}
+
+void HidrawBackend::printStats() const {
+    for (int i = 0; i < deviceCount_; ++i) {
+        devices_[i].decoder.printStats(devices_[i].path);
+    }
+    printf("hidraw: %llu wakeups, %llu reads, %llu failed writes\n", (unsigned long long)wakeups_,
+           (unsigned long long)reads_, (unsigned long long)outputErrors_);
+}
+
+#endif // __linux__
@@ -0,0 +1,117 @@
+#ifndef HIDRAW_BACKEND_H
+#define HIDRAW_BACKEND_H
+
+#ifdef __linux__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dualsense.h"
+#include "dualsense_decoder.h"
+#include "input_backend.h"
+
+#ifdef PS5_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+// Linux input straight from /dev/hidrawN, without hidapi's reader thread and
+// the extra copy it makes.
+//
+// DualSense devices are found through sysfs by vendor and product id, and all
+// of them are waited on in one epoll loop; each wakeup reads a device until
+// the kernel queue is empty. Every controller gets its own decoder and its
+// slot index as Sample::controller. New controllers are picked up at each
+// status check.
+//
+// With useIoUring (builds with PS5_HAVE_LIBURING only) a read stays posted on
+// every device instead, so a report is copied straight into our buffer
+// without a readiness round trip.
+//
+// After each wakeup every controller gets at most one output report with its
+// pending rumble, light and trigger settings (see DsOutputScheduler).
+//
+// The sensor calibration of a controller is read once and cached by its
+// unique id, the Bluetooth address (see dualsense_calibration.h), and so is
+// the gyro bias learned while it lies still (see GyroBiasEstimator).
+// Replayed reports use the nominal scale.
+//
+// replaySource reads reports recorded with recordPath instead of devices:
+// a path, "-" for stdin or "fd:N". A recording is a sequence of reports, each
+// preceded by its length as a little-endian uint16. Replay is as fast as the
+// transmit thread drains the sample ring, so no report is dropped.
+class HidrawBackend : public InputBackend {
+public:
+    struct Options {
+        const char* replaySource = nullptr;
+        const char* recordPath = nullptr;
+        bool useIoUring = false;
+    };
+
+    HidrawBackend(SampleSink& sink, const Options& options);
+    ~HidrawBackend() override;
+
+    const char* name() const override { return "hidraw"; }
+    bool open() override;
+    bool pump(int timeoutMs) override;
+    void checkStatus() override;
+    void printStats() const override;
+    void close() override;
+
+private:
+    static const int MAX_DEVICES = 8;
+    static const int MAX_REPORT_SIZE = DS_INPUT_REPORT_BT_SIZE;
+    static const size_t REPLAY_BUFFER_SIZE = 4096;
+
+    struct Device {
+        int fd = -1;
+        char path[64] = {0};
+        char serial[64] = {0};
+        bool replay = false;
+        bool featureRead = false; // the calibration report was requested
+        bool pollable = true; // regular files cannot be waited on with epoll
+        DualSenseDecoder decoder;
+        uint8_t report[MAX_REPORT_SIZE];        // io_uring read target
+        uint8_t replayBuffer[REPLAY_BUFFER_SIZE];
+        size_t replayFill = 0;
+    };
+
+    void discover();
+    bool isOpen(const char* path) const;
+    int addDevice(int fd, const char* path, bool replay);
+    bool openDevice(const char* path);
+    bool readCalibration(Device& device, DsCalibration* calibration);
+    void loadCalibration(Device& device);
+    void storeGyroBias(Device& device);
+    bool openReplay(const char* source);
+    void removeDevice(Device& device, const char* reason);
+
+    void readDevice(Device& device);
+    void readReplay(Device& device);
+    void handleReport(Device& device, const uint8_t* data, int length, uint64_t arrivalUs);
+    void writeOutput(Device& device, uint64_t nowUs);
+    bool replayHasRoom() const;
+
+    bool pumpEpoll(int timeoutMs);
+#ifdef PS5_HAVE_LIBURING
+    void postRead(int slot);
+    bool pumpUring(int timeoutMs);
+#endif
+
+    SampleSink& sink_;
+    Options options_;
+    Device devices_[MAX_DEVICES];
+    int deviceCount_ = 0;  // slots used, including removed devices
+    int activeDevices_ = 0;
+    int epollFd_ = -1;
+    int recordFd_ = -1;
+    bool useIoUring_ = false;
+#ifdef PS5_HAVE_LIBURING
+    struct io_uring ring_;
+#endif
+    uint64_t wakeups_ = 0;
+    uint64_t reads_ = 0;
+    uint64_t outputErrors_ = 0;
+};
+
+#endif // __linux__
+
+#endif // HIDRAW_BACKEND_H
@@ -0,0 +1,27 @@
+#ifndef HOST_CLOCK_H
+#define HOST_CLOCK_H
+
+#include <chrono>
+#include <stdint.h>
+
+// Microseconds on the host's monotonic clock
+inline uint64_t hostMonotonicUs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Convert a host monotonic time to an NTP timestamp (as used by OSC timetags).
+// The monotonic/wall-clock relation is captured once so timetags never jump
+// when the wall clock is adjusted during a session.
+inline void hostUsToNtp(uint64_t hostUs, uint32_t* seconds, uint32_t* fraction) {
+    static const uint64_t NTP_UNIX_OFFSET = 2208988800ULL; // 1900-01-01 to 1970-01-01
+    static const int64_t wallMinusMonotonicUs =
+        (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count() - (int64_t)hostMonotonicUs();
+
+    uint64_t wallUs = (uint64_t)((int64_t)hostUs + wallMinusMonotonicUs);
+    *seconds = (uint32_t)(wallUs / 1000000 + NTP_UNIX_OFFSET);
+    *fraction = (uint32_t)(((wallUs % 1000000) << 32) / 1000000);
+}
+
+#endif // HOST_CLOCK_H
@@ -0,0 +1,183 @@
+#include "imu_batch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define IMU_BATCH_X86 1
+#endif
+
+namespace {
+
+const DsField AXIS_FIELDS[IMU_AXES] = {
+    DS_FIELD_GYRO_X, DS_FIELD_GYRO_Y, DS_FIELD_GYRO_Z, DS_FIELD_ACCEL_X, DS_FIELD_ACCEL_Y, DS_FIELD_ACCEL_Z,
+};
+
+void decodeScalar(const DsReportLayout& layout, const uint8_t* reports, size_t stride, size_t begin, size_t count,
+                  const ImuAxisScale& scale, const ImuBatchOutput& out) {
+    unsigned offsets[IMU_AXES];
+    for (int a = 0; a < IMU_AXES; ++a) {
+        offsets[a] = layout.fields[AXIS_FIELDS[a]].offset;
+    }
+    for (int a = 0; a < IMU_AXES; ++a) {
+        const uint8_t* field = reports + offsets[a];
+        float* dst = out.axis[a];
+        for (size_t i = begin; i < count; ++i) {
+            dst[i] = dsReadLe16(field + i * stride) * scale.scale[a] + scale.offset[a];
+        }
+    }
+}
+
+#ifdef IMU_BATCH_X86
+
+// The vector kernels read 16 bytes from the gyro x offset: the six int16 axes back to back, then 4 more bytes
+const unsigned VECTOR_LOAD_BYTES = 16;
+
+bool sensorsContiguous(const DsReportLayout& layout) {
+    for (int a = 0; a < IMU_AXES; ++a) {
+        const DsFieldLayout& field = layout.fields[AXIS_FIELDS[a]];
+        if (field.width != 2 || !field.isSigned || field.offset != layout.fields[DS_FIELD_GYRO_X].offset + 2 * a) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 4 reports per step: widen each report's axes into two rows (gx gy gz ax, ay az - -),
+// apply the scale, then transpose the rows into per-axis columns
+__attribute__((target("sse4.1")))
+size_t decodeSse41(const uint8_t* sensors, size_t stride, size_t count, const ImuAxisScale& s, const ImuBatchOutput& out) {
+    const __m128 scaleLo = _mm_setr_ps(s.scale[0], s.scale[1], s.scale[2], s.scale[3]);
+    const __m128 offsetLo = _mm_setr_ps(s.offset[0], s.offset[1], s.offset[2], s.offset[3]);
+    const __m128 scaleHi = _mm_setr_ps(s.scale[4], s.scale[5], 0.0f, 0.0f);
+    const __m128 offsetHi = _mm_setr_ps(s.offset[4], s.offset[5], 0.0f, 0.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 lo[4];
+        __m128 hi[4];
+        for (int r = 0; r < 4; ++r) {
+            __m128i raw = _mm_loadu_si128((const __m128i*)(sensors + (i + r) * stride));
+            lo[r] = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(raw)), scaleLo), offsetLo);
+            hi[r] = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(raw, 8))), scaleHi),
+                               offsetHi);
+        }
+        _MM_TRANSPOSE4_PS(lo[0], lo[1], lo[2], lo[3]);
+        for (int a = 0; a < 4; ++a) {
+            _mm_storeu_ps(out.axis[a] + i, lo[a]);
+        }
+        __m128 t01 = _mm_unpacklo_ps(hi[0], hi[1]); // ay0 ay1 az0 az1
+        __m128 t23 = _mm_unpacklo_ps(hi[2], hi[3]);
+        _mm_storeu_ps(out.axis[4] + i, _mm_movelh_ps(t01, t23));
+        _mm_storeu_ps(out.axis[5] + i, _mm_movehl_ps(t23, t01));
+    }
+    return i;
+}
+
+// 8 reports per step: each report widens to one row of 8 (six axes and the
+// timestamp halves), an 8x8 transpose turns the rows into axis columns
+__attribute__((target("avx2,fma")))
+size_t decodeAvx2(const uint8_t* sensors, size_t stride, size_t count, const ImuAxisScale& s, const ImuBatchOutput& out) {
+    const __m256 scale = _mm256_setr_ps(s.scale[0], s.scale[1], s.scale[2], s.scale[3], s.scale[4], s.scale[5], 0.0f, 0.0f);
+    const __m256 offset =
+        _mm256_setr_ps(s.offset[0], s.offset[1], s.offset[2], s.offset[3], s.offset[4], s.offset[5], 0.0f, 0.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 row[8];
+        for (int r = 0; r < 8; ++r) {
+            __m128i raw = _mm_loadu_si128((const __m128i*)(sensors + (i + r) * stride));
+            row[r] = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(raw)), scale, offset);
+        }
+
+        // Within each 128-bit lane: columns k and k + 4 of four rows
+        __m256 pair[8];
+        for (int h = 0; h < 2; ++h) {
+            const __m256* r = row + 4 * h;
+            __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+            __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+            __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+            __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+            pair[4 * h + 0] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+            pair[4 * h + 1] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+            pair[4 * h + 2] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+            pair[4 * h + 3] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        }
+        for (int a = 0; a < 4; ++a) {
+            _mm256_storeu_ps(out.axis[a] + i, _mm256_permute2f128_ps(pair[a], pair[4 + a], 0x20));
+        }
+        _mm256_storeu_ps(out.axis[4] + i, _mm256_permute2f128_ps(pair[0], pair[4], 0x31));
+        _mm256_storeu_ps(out.axis[5] + i, _mm256_permute2f128_ps(pair[1], pair[5], 0x31));
+    }
+    return i;
+}
+
+#endif // IMU_BATCH_X86
+
+ImuBatchKernel detectKernel() {
+    if (imuBatchKernelSupported(IMU_KERNEL_AVX2)) {
+        return IMU_KERNEL_AVX2;
+    }
+    if (imuBatchKernelSupported(IMU_KERNEL_SSE41)) {
+        return IMU_KERNEL_SSE41;
+    }
+    return IMU_KERNEL_SCALAR;
+}
+
+} // namespace
+
+const char* imuBatchKernelName(ImuBatchKernel kernel) {
+    switch (kernel) {
+        case IMU_KERNEL_SSE41:
+            return "sse4.1";
+        case IMU_KERNEL_AVX2:
+            return "avx2";
+        default:
+            return "scalar";
+    }
+}
+
+bool imuBatchKernelSupported(ImuBatchKernel kernel) {
+    switch (kernel) {
+        case IMU_KERNEL_SCALAR:
+            return true;
+#ifdef IMU_BATCH_X86
+        case IMU_KERNEL_SSE41:
+            return __builtin_cpu_supports("sse4.1");
+        case IMU_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+        default:
+            return false;
+    }
+}
+
+ImuBatchKernel imuBatchBestKernel() {
+    static const ImuBatchKernel best = detectKernel();
+    return best;
+}
+
+bool imuBatchDecode(const DsReportLayout& layout, const uint8_t* reports, size_t stride, size_t count,
+                    const ImuAxisScale& scale, const ImuBatchOutput& out) {
+    return imuBatchDecode(layout, reports, stride, count, scale, out, imuBatchBestKernel());
+}
+
+bool imuBatchDecode(const DsReportLayout& layout, const uint8_t* reports, size_t stride, size_t count,
+                    const ImuAxisScale& scale, const ImuBatchOutput& out, ImuBatchKernel kernel) {
+    if (!layout.hasSensors() || stride < layout.size) {
+        return false;
+    }
+
+    size_t done = 0;
+#ifdef IMU_BATCH_X86
+    unsigned sensorOffset = layout.fields[DS_FIELD_GYRO_X].offset;
+    bool vectorizable = sensorsContiguous(layout) && sensorOffset + VECTOR_LOAD_BYTES <= layout.size;
+    if (vectorizable && kernel == IMU_KERNEL_AVX2 && imuBatchKernelSupported(IMU_KERNEL_AVX2)) {
+        done = decodeAvx2(reports + sensorOffset, stride, count, scale, out);
+    } else if (vectorizable && kernel == IMU_KERNEL_SSE41 && imuBatchKernelSupported(IMU_KERNEL_SSE41)) {
+        done = decodeSse41(reports + sensorOffset, stride, count, scale, out);
+    }
+#else
+    (void)kernel;
+#endif
+    decodeScalar(layout, reports, stride, done, count, scale, out);
+    return true;
+}
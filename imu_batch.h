@@ -0,0 +1,48 @@
+#ifndef IMU_BATCH_H
+#define IMU_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dualsense_calibration.h"
+#include "dualsense_layout.h"
+
+// Batch conversion of raw DualSense reports to calibrated IMU floats, a
+// library API for tools that replay recordings or analyse them offline. The
+// streaming app decodes report by report (DualSenseDecoder) and does not use
+// it; only the benchmark is built with it.
+//
+// The input is an array of equally sized reports of one variant; the output
+// is one float array per axis (struct of arrays), each value raw * scale +
+// offset. The x86 kernels load the twelve sensor bytes of 4 (SSE4.1) or 8
+// (AVX2) reports, widen them and transpose the reports into axis rows. The
+// kernel is picked at runtime from what the CPU supports; everything else
+// uses the scalar loop.
+
+enum ImuBatchKernel {
+    IMU_KERNEL_SCALAR,
+    IMU_KERNEL_SSE41,
+    IMU_KERNEL_AVX2,
+    IMU_KERNEL_COUNT
+};
+
+// The output has the axis order of ImuAxisScale (dualsense_calibration.h):
+// gyro x, y, z, then accel x, y, z
+struct ImuBatchOutput {
+    float* axis[IMU_AXES]; // each at least count floats
+};
+
+const char* imuBatchKernelName(ImuBatchKernel kernel);
+bool imuBatchKernelSupported(ImuBatchKernel kernel);
+ImuBatchKernel imuBatchBestKernel(); // detected once
+
+// Convert count reports of layout, stride bytes apart. Returns false without
+// writing anything if the layout carries no sensors or the reports are
+// shorter than the layout requires.
+bool imuBatchDecode(const DsReportLayout& layout, const uint8_t* reports, size_t stride, size_t count,
+                    const ImuAxisScale& scale, const ImuBatchOutput& out);
+
+// Same with an explicit kernel, for benchmarks; falls back to scalar if unsupported
+bool imuBatchDecode(const DsReportLayout& layout, const uint8_t* reports, size_t stride, size_t count,
+                    const ImuAxisScale& scale, const ImuBatchOutput& out, ImuBatchKernel kernel);
+
+#endif // IMU_BATCH_H
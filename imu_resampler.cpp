@@ -0,0 +1,118 @@
+#include "imu_resampler.h"
+
+#include <string.h>
+
+ImuResampler::ImuResampler(double rateHz, uint64_t delayUs, ResampleInterpolation interpolation, uint64_t originUs)
+    : periodUs_(rateHz > 0 ? (uint64_t)(1000000.0 / rateHz + 0.5) : 1000),
+      delayUs_(delayUs),
+      interpolation_(interpolation),
+      originUs_(originUs) {
+    if (periodUs_ == 0) {
+        periodUs_ = 1;
+    }
+}
+
+void ImuResampler::add(const Sample& sample) {
+    if (sample.kind != SAMPLE_IMU || sample.controller < 0 || sample.controller >= MAX_CONTROLLERS) {
+        return;
+    }
+    Controller& controller = controllers_[sample.controller];
+    uint64_t timeUs = sample.hostTimeUs;
+    if (controller.count > 0 && timeUs <= entry(controller, 0).timeUs) {
+        return; // the decoder already drops late reports; this only guards the interpolation
+    }
+
+    controller.newest = (controller.newest + 1) % HISTORY;
+    Entry& e = controller.history[controller.newest];
+    e.timeUs = timeUs;
+    memcpy(e.data, sample.data, sizeof(e.data));
+    controller.count = controller.count < HISTORY ? controller.count + 1 : HISTORY;
+
+    // (Re)start the output at the first grid time not before this sample
+    if (controller.gridUs == 0) {
+        uint64_t since = timeUs > originUs_ ? timeUs - originUs_ : 0;
+        controller.gridUs = originUs_ + (since + periodUs_ - 1) / periodUs_ * periodUs_;
+    }
+}
+
+bool ImuResampler::next(uint64_t nowUs, Sample* sample) {
+    for (;;) {
+        // The earliest due grid time of all controllers, so the output stays in time order
+        int due = -1;
+        for (int c = 0; c < MAX_CONTROLLERS; ++c) {
+            uint64_t gridUs = controllers_[c].gridUs;
+            if (gridUs != 0 && gridUs + delayUs_ <= nowUs && (due < 0 || gridUs < controllers_[due].gridUs)) {
+                due = c;
+            }
+        }
+        if (due < 0) {
+            return false;
+        }
+
+        Controller& controller = controllers_[due];
+        if (controller.gridUs > entry(controller, 0).timeUs + MAX_HOLD_US) {
+            controller.gridUs = 0; // the controller went quiet
+            continue;
+        }
+        *sample = Sample();
+        sample->kind = SAMPLE_IMU;
+        sample->controller = due;
+        sample->timestampUs = controller.gridUs;
+        sample->hostTimeUs = controller.gridUs;
+        interpolate(controller, controller.gridUs, sample->data);
+        controller.gridUs += periodUs_;
+        return true;
+    }
+}
+
+uint64_t ImuResampler::deadlineUs() const {
+    uint64_t deadline = UINT64_MAX;
+    for (const Controller& controller : controllers_) {
+        if (controller.gridUs != 0 && controller.gridUs + delayUs_ < deadline) {
+            deadline = controller.gridUs + delayUs_;
+        }
+    }
+    return deadline;
+}
+
+void ImuResampler::interpolate(const Controller& controller, uint64_t timeUs, float* data) const {
+    // The newest sample not after timeUs; holding the newest or oldest outside the history
+    int age = 0;
+    while (age < controller.count && entry(controller, age).timeUs > timeUs) {
+        age++;
+    }
+    if (age == 0 || age == controller.count) {
+        memcpy(data, entry(controller, age == 0 ? 0 : controller.count - 1).data, 6 * sizeof(float));
+        return;
+    }
+
+    const Entry& p1 = entry(controller, age);
+    const Entry& p2 = entry(controller, age - 1);
+    float h = (float)(p2.timeUs - p1.timeUs);
+    float s = (float)(timeUs - p1.timeUs) / h;
+
+    if (interpolation_ == RESAMPLE_LINEAR) {
+        for (int i = 0; i < 6; ++i) {
+            data[i] = p1.data[i] + s * (p2.data[i] - p1.data[i]);
+        }
+        return;
+    }
+
+    // Cubic Hermite; the tangents are central differences over the actual
+    // sample times, one-sided at the ends of the history
+    const Entry& p0 = age + 1 < controller.count ? entry(controller, age + 1) : p1;
+    const Entry& p3 = age >= 2 ? entry(controller, age - 2) : p2;
+    float span1 = (float)(p2.timeUs - p0.timeUs);
+    float span2 = (float)(p3.timeUs - p1.timeUs);
+    float s2 = s * s;
+    float s3 = s2 * s;
+    float h00 = 2.0f * s3 - 3.0f * s2 + 1.0f;
+    float h10 = s3 - 2.0f * s2 + s;
+    float h01 = -2.0f * s3 + 3.0f * s2;
+    float h11 = s3 - s2;
+    float w1 = h10 * h / span1;
+    float w2 = h11 * h / span2;
+    for (int i = 0; i < 6; ++i) {
+        data[i] = h00 * p1.data[i] + h01 * p2.data[i] + w1 * (p2.data[i] - p0.data[i]) + w2 * (p3.data[i] - p1.data[i]);
+    }
+}
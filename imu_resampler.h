@@ -0,0 +1,65 @@
+#ifndef IMU_RESAMPLER_H
+#define IMU_RESAMPLER_H
+
+#include <stdint.h>
+#include "sample.h"
+
+enum ResampleInterpolation : uint8_t {
+    RESAMPLE_LINEAR,
+    RESAMPLE_CUBIC, // Hermite with tangents from the neighbouring samples
+};
+
+// Turns the irregular SAMPLE_IMU stream of every controller into samples on a
+// uniform clock, so consumers see a fixed rate whatever the transport does.
+//
+// Output times lie on a grid of periodUs from originUs, shared by all
+// controllers. The sample for grid time t is produced once the host clock
+// passes t + delayUs, interpolated from the last HISTORY input samples around
+// t. The delay is the one knob: a longer one waits for the samples after t to
+// arrive, so bursts and late reports still interpolate; a shorter one is
+// sooner but holds the newest sample when t is past it. Once a controller has
+// sent nothing for MAX_HOLD_US its output stops until it sends again.
+class ImuResampler {
+public:
+    static const int MAX_CONTROLLERS = 8;
+    static const int HISTORY = 32;            // input samples kept per controller
+    static const uint64_t MAX_HOLD_US = 50000;
+
+    ImuResampler(double rateHz, uint64_t delayUs, ResampleInterpolation interpolation, uint64_t originUs);
+
+    void add(const Sample& sample);
+
+    // The next due output sample of any controller; false when none is due at nowUs
+    bool next(uint64_t nowUs, Sample* sample);
+
+    // Host time the next output sample is due, UINT64_MAX if none is pending
+    uint64_t deadlineUs() const;
+
+    uint64_t periodUs() const { return periodUs_; }
+
+private:
+    struct Entry {
+        uint64_t timeUs;
+        float data[6];
+    };
+
+    struct Controller {
+        Entry history[HISTORY];
+        int newest = -1; // index of the newest entry, -1 while empty
+        int count = 0;
+        uint64_t gridUs = 0; // next output time, 0 while stopped
+    };
+
+    const Entry& entry(const Controller& controller, int age) const {
+        return controller.history[(controller.newest - age + HISTORY) % HISTORY];
+    }
+    void interpolate(const Controller& controller, uint64_t timeUs, float* data) const;
+
+    uint64_t periodUs_;
+    uint64_t delayUs_;
+    ResampleInterpolation interpolation_;
+    uint64_t originUs_;
+    Controller controllers_[MAX_CONTROLLERS];
+};
+
+#endif // IMU_RESAMPLER_H
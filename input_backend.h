@@ -0,0 +1,119 @@
+#ifndef INPUT_BACKEND_H
+#define INPUT_BACKEND_H
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <lo/lo.h>
+#include "gyro_bias.h"
+#include "host_clock.h"
+#include "input_state.h"
+#include "latency_probe.h"
+#include "output_control.h"
+#include "report_loss.h"
+#include "sample.h"
+#include "shm_output.h"
+#include "spsc_ring.h"
+
+// Accounting of individual sensor readings (a SAMPLE_IMU carries two), so drops are visible.
+// received is owned by the acquisition thread, forwarded by the transmit thread.
+struct SampleCounters {
+    uint64_t received = 0;
+    std::atomic<uint64_t> forwarded{0};
+    uint64_t receivedAtLastReport = 0;
+};
+
+// Where input backends deliver their samples: the ring to the transmit
+// thread, the optional shared-memory stream and the accounting. It also
+// holds the output settings going the other way.
+struct SampleSink {
+    SpscRing<Sample>* ring = nullptr;
+    ShmOutput* shm = nullptr;           // optional same-host output, written directly from this thread
+    SampleCounters* counters = nullptr;
+    LatencyProbe* latency = nullptr;    // set in the jitter comparison mode
+    lo_address status = nullptr;        // status messages, sent from this thread through liblo
+    OutputControl* output = nullptr;    // rumble, light and trigger settings for the backend to write, optional
+
+    // readings = sensor readings carried by the sample (0 for buttons and axes)
+    void emit(const Sample& sample, unsigned readings) {
+        if (latency && sample.timestampUs != 0) {
+            latency->record(hostMonotonicUs() - sample.hostTimeUs);
+        }
+        counters->received += readings;
+        if (shm) {
+            shm->publish(sample);
+        }
+        ring->tryPush(sample);
+    }
+
+    // Emit what changed in a decoded input state: buttons, axes and touches as
+    // samples, battery and headphone changes as /ps5/power controller
+    // battery% charging headphones microphone
+    void emitStateChanges(int32_t controller, const DsInputState& state, const DsStateDelta& delta,
+                          uint64_t hostTimeUs) {
+        Sample samples[DS_MAX_DELTA_SAMPLES];
+        int count = dsDeltaSamples(state, delta, controller, hostTimeUs, samples);
+        for (int i = 0; i < count; ++i) {
+            emit(samples[i], 0);
+        }
+        if (delta.has(DS_STATE_POWER) && status) {
+            lo_send(status, "/ps5/power", "iiiii", controller, (int32_t)state.battery,
+                    (state.power & DS_POWER_CHARGING) ? 1 : 0, (state.power & DS_POWER_HEADPHONES) ? 1 : 0,
+                    (state.power & DS_POWER_MICROPHONE) ? 1 : 0);
+        }
+    }
+
+    // Print and send the report loss of one controller since the previous call:
+    // /ps5/stats controller received dropped duplicated out_of_order loss% total_loss%
+    void reportLoss(const char* label, int32_t controller, ReportLossTracker& loss) {
+        ReportLossStats interval = loss.takeInterval();
+        if (interval.dropped || interval.duplicated || interval.outOfOrder) {
+            printf("%s: %llu reports dropped (%.2f%%), %llu duplicated, %llu out of order\n", label,
+                   (unsigned long long)interval.dropped, interval.lossPercent(),
+                   (unsigned long long)interval.duplicated, (unsigned long long)interval.outOfOrder);
+        }
+        if (status) {
+            lo_send(status, "/ps5/stats", "iiiiiff", controller, (int32_t)interval.received,
+                    (int32_t)interval.dropped, (int32_t)interval.duplicated, (int32_t)interval.outOfOrder,
+                    (float)interval.lossPercent(), (float)loss.totals().lossPercent());
+        }
+    }
+
+
+    // Send the learned gyro bias (rad/s) and stillness of one controller:
+    // /ps5/gyro_bias controller x y z still
+    void reportGyroBias(int32_t controller, const GyroBiasEstimator& gyroBias) {
+        if (status) {
+            const float* bias = gyroBias.bias();
+            lo_send(status, "/ps5/gyro_bias", "ifffi", controller, bias[0], bias[1], bias[2], gyroBias.still() ? 1 : 0);
+        }
+    }
+};
+
+// A source of controller input. Backends run on the acquisition thread and
+// hand every sample to a SampleSink; everything after the sink is shared.
+class InputBackend {
+public:
+    virtual ~InputBackend() {}
+
+    virtual const char* name() const = 0;
+
+    // Find and open the controller
+    virtual bool open() = 0;
+
+    // Wait up to timeoutMs for input and emit what arrived. Returns false once
+    // the controller is gone or the backend asked to quit.
+    virtual bool pump(int timeoutMs) = 0;
+
+    // Called about once per second from the acquisition thread
+    virtual void checkStatus() {}
+
+    // True if gyro and accel arrive together as SAMPLE_IMU
+    virtual bool pairsImu() const { return true; }
+
+    virtual void printStats() const {}
+
+    virtual void close() = 0;
+};
+
+#endif // INPUT_BACKEND_H
@@ -0,0 +1,42 @@
+#include "input_state.h"
+
+// SDL's ranges: sticks -32768..32767, triggers 0..32767
+static int32_t axisValue(int axis, uint8_t raw) {
+    return axis >= DS_AXIS_L2 ? raw * 32767 / 255 : raw * 257 - 32768;
+}
+
+static Sample deltaSample(SampleKind kind, int32_t controller, uint64_t hostTimeUs, int32_t code, int32_t value) {
+    Sample sample = {};
+    sample.kind = kind;
+    sample.controller = controller;
+    sample.code = code;
+    sample.value = value;
+    sample.hostTimeUs = hostTimeUs;
+    return sample;
+}
+
+int dsDeltaSamples(const DsInputState& state, const DsStateDelta& delta, int32_t controller, uint64_t hostTimeUs,
+                   Sample* samples) {
+    int count = 0;
+    for (uint32_t changed = delta.buttons; changed != 0; changed &= changed - 1) {
+        int button = __builtin_ctz(changed);
+        samples[count++] = deltaSample(SAMPLE_BUTTON, controller, hostTimeUs, button, (state.buttons >> button) & 1);
+    }
+
+    for (uint32_t changed = delta.axes; changed != 0; changed &= changed - 1) {
+        int axis = __builtin_ctz(changed);
+        samples[count++] = deltaSample(SAMPLE_AXIS, controller, hostTimeUs, axis, axisValue(axis, state.axis[axis]));
+    }
+
+    for (int finger = 0; finger < 2; ++finger) {
+        if (delta.has(finger == 0 ? DS_STATE_TOUCH_0 : DS_STATE_TOUCH_1)) {
+            const DsTouch& touch = state.touch[finger];
+            Sample sample = deltaSample(SAMPLE_TOUCH, controller, hostTimeUs, finger, touch.down);
+            sample.data[0] = (float)touch.x / (DS_TOUCHPAD_WIDTH - 1);
+            sample.data[1] = (float)touch.y / (DS_TOUCHPAD_HEIGHT - 1);
+            sample.data[2] = touch.id;
+            samples[count++] = sample;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,337 @@
+#ifndef INPUT_STATE_H
+#define INPUT_STATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+#include "dualsense_layout.h"
+#include "sample.h"
+
+// The complete input state of one DualSense report, packed into one cache
+// line, and the difference between two of them.
+//
+// Every field group sits inside one of the eight 64-bit words, so a diff is
+// eight XORs and one mask test per group; downstream stages look only at the
+// groups that changed instead of the whole controller.
+
+// Buttons, numbered like SDL_GameControllerButton so both backends send the same /ps5/button codes
+enum DsButton : uint8_t {
+    DS_BUTTON_CROSS = 0,
+    DS_BUTTON_CIRCLE = 1,
+    DS_BUTTON_SQUARE = 2,
+    DS_BUTTON_TRIANGLE = 3,
+    DS_BUTTON_CREATE = 4,
+    DS_BUTTON_PS = 5,
+    DS_BUTTON_OPTIONS = 6,
+    DS_BUTTON_L3 = 7,
+    DS_BUTTON_R3 = 8,
+    DS_BUTTON_L1 = 9,
+    DS_BUTTON_R1 = 10,
+    DS_BUTTON_DPAD_UP = 11,
+    DS_BUTTON_DPAD_DOWN = 12,
+    DS_BUTTON_DPAD_LEFT = 13,
+    DS_BUTTON_DPAD_RIGHT = 14,
+    DS_BUTTON_MUTE = 15,
+    DS_BUTTON_TOUCHPAD = 20,
+};
+
+// Axes, numbered like SDL_GameControllerAxis
+enum DsAxis : uint8_t {
+    DS_AXIS_LEFT_X,
+    DS_AXIS_LEFT_Y,
+    DS_AXIS_RIGHT_X,
+    DS_AXIS_RIGHT_Y,
+    DS_AXIS_L2,
+    DS_AXIS_R2,
+    DS_AXIS_COUNT
+};
+
+// DsInputState::power bits
+enum : uint8_t {
+    DS_POWER_CHARGING = 1 << 0,
+    DS_POWER_FULL = 1 << 1,
+    DS_POWER_HEADPHONES = 1 << 2,
+    DS_POWER_MICROPHONE = 1 << 3,
+};
+
+// Touchpad resolution
+static const int DS_TOUCHPAD_WIDTH = 1920;
+static const int DS_TOUCHPAD_HEIGHT = 1080;
+
+struct DsTouch {
+    uint16_t x;
+    uint16_t y;
+    uint8_t id;   // increments with every new contact
+    uint8_t down;
+    uint8_t reserved[2];
+};
+
+struct alignas(64) DsInputState {
+    // word 0
+    uint8_t axis[DS_AXIS_COUNT]; // sticks 0..255 with 128 centred, triggers 0..255
+    uint8_t battery;             // percent
+    uint8_t power;               // DS_POWER_* flags
+    // word 1
+    uint32_t buttons;            // bit per DsButton
+    uint32_t sensorTime;         // 1/3 us ticks, not compared
+    // word 2
+    int16_t gyro[3];             // raw sensor units
+    uint8_t sequence;            // not compared
+    uint8_t reserved0;
+    // word 3
+    int16_t accel[3];
+    uint8_t reserved1[2];
+    // words 4 and 5
+    DsTouch touch[2];
+    // words 6 and 7
+    uint8_t reserved2[16];
+};
+
+static_assert(sizeof(DsInputState) == 64, "DsInputState fills exactly one cache line");
+
+// Groups of state a delta reports, as bits of DsStateDelta::fields
+enum DsStateField : uint8_t {
+    DS_STATE_LEFT_STICK,
+    DS_STATE_RIGHT_STICK,
+    DS_STATE_L2,
+    DS_STATE_R2,
+    DS_STATE_POWER,      // battery, charging, headphones and microphone
+    DS_STATE_BUTTONS,
+    DS_STATE_GYRO,
+    DS_STATE_ACCEL,
+    DS_STATE_TOUCH_0,
+    DS_STATE_TOUCH_1,
+    DS_STATE_FIELD_COUNT
+};
+
+struct DsStateDelta {
+    uint32_t fields = 0;  // bit per DsStateField that changed
+    uint32_t buttons = 0; // buttons that changed (pressed or released)
+    uint32_t axes = 0;    // bit per DsAxis that moved
+
+    bool has(DsStateField field) const { return (fields >> field) & 1; }
+};
+
+namespace dsstate {
+
+struct FieldBits {
+    uint8_t word;
+    uint64_t mask;
+};
+
+// Mask of bytes [offset, offset + size) within their 64-bit word, as loaded by memcpy
+constexpr FieldBits fieldBits(unsigned offset, unsigned size) {
+    uint64_t mask = 0;
+    for (unsigned i = offset; i < offset + size; ++i) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        mask |= (uint64_t)0xFF << (8 * (7 - i % 8));
+#else
+        mask |= (uint64_t)0xFF << (8 * (i % 8));
+#endif
+    }
+    return FieldBits{(uint8_t)(offset / 8), mask};
+}
+
+#define DS_STATE_BITS(member, size) fieldBits(offsetof(DsInputState, member), size)
+
+constexpr FieldBits FIELD_BITS[DS_STATE_FIELD_COUNT] = {
+    DS_STATE_BITS(axis[DS_AXIS_LEFT_X], 2),
+    DS_STATE_BITS(axis[DS_AXIS_RIGHT_X], 2),
+    DS_STATE_BITS(axis[DS_AXIS_L2], 1),
+    DS_STATE_BITS(axis[DS_AXIS_R2], 1),
+    DS_STATE_BITS(battery, 2),
+    DS_STATE_BITS(buttons, 4),
+    DS_STATE_BITS(gyro, 6),
+    DS_STATE_BITS(accel, 6),
+    DS_STATE_BITS(touch[0], 6),
+    DS_STATE_BITS(touch[1], 6),
+};
+
+#undef DS_STATE_BITS
+
+// Bit of each button in the report's 24-bit button field; the low nibble is the d-pad hat
+struct ButtonBit {
+    uint8_t bit;
+    DsButton button;
+};
+
+constexpr ButtonBit REPORT_BUTTONS[] = {
+    {4, DS_BUTTON_SQUARE}, {5, DS_BUTTON_CROSS}, {6, DS_BUTTON_CIRCLE}, {7, DS_BUTTON_TRIANGLE},
+    {8, DS_BUTTON_L1}, {9, DS_BUTTON_R1}, {12, DS_BUTTON_CREATE}, {13, DS_BUTTON_OPTIONS},
+    {14, DS_BUTTON_L3}, {15, DS_BUTTON_R3}, {16, DS_BUTTON_PS}, {17, DS_BUTTON_TOUCHPAD}, {18, DS_BUTTON_MUTE},
+};
+
+// D-pad hat (0 = up, clockwise in eighths, 8 or more = released) to button bits
+constexpr uint32_t hatButtons(unsigned hat) {
+    const uint32_t up = 1u << DS_BUTTON_DPAD_UP, right = 1u << DS_BUTTON_DPAD_RIGHT;
+    const uint32_t down = 1u << DS_BUTTON_DPAD_DOWN, left = 1u << DS_BUTTON_DPAD_LEFT;
+    const uint32_t bits[8] = {up, up | right, right, down | right, down, down | left, left, up | left};
+    return hat < 8 ? bits[hat] : 0;
+}
+
+// Button bits contributed by each byte of the report's button field, so
+// decoding the buttons is three table lookups
+struct ButtonTable {
+    uint32_t byte[3][256];
+};
+
+constexpr ButtonTable makeButtonTable() {
+    ButtonTable table{};
+    for (unsigned value = 0; value < 256; ++value) {
+        table.byte[0][value] = hatButtons(value & 0x0F);
+        for (const ButtonBit& b : REPORT_BUTTONS) {
+            table.byte[b.bit / 8][value] |= ((value >> (b.bit % 8)) & 1u) << b.button;
+        }
+    }
+    return table;
+}
+
+inline constexpr ButtonTable BUTTON_TABLE = makeButtonTable();
+
+inline uint64_t loadWord(const DsInputState* state, int word) {
+    uint64_t value;
+    memcpy(&value, reinterpret_cast<const uint8_t*>(state) + 8 * word, sizeof(value));
+    return value;
+}
+
+inline void storeWord(DsInputState* state, int word, uint64_t value) {
+    memcpy(reinterpret_cast<uint8_t*>(state) + 8 * word, &value, sizeof(value));
+}
+
+
+} // namespace dsstate
+
+namespace dsstate {
+
+// Place a value of the given size at a member's position within its 64-bit word
+constexpr uint64_t place(uint64_t value, unsigned offset, unsigned size) {
+    (void)size;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return value << (8 * (8 - offset % 8 - size));
+#else
+    return value << (8 * (offset % 8));
+#endif
+}
+
+#define DS_STATE_PLACE(member, ...) \
+    place((uint64_t)(__VA_ARGS__), offsetof(DsInputState, member), sizeof(DsInputState::member))
+
+// A touch point of the report (bit 7: not touching, bits 0-6: contact id, then 12-bit x and y) as a DsTouch word
+inline uint64_t packTouch(uint32_t raw) {
+    return place((raw >> 8) & 0xFFF, offsetof(DsTouch, x), 2) | place(raw >> 20, offsetof(DsTouch, y), 2) |
+           place(raw & 0x7F, offsetof(DsTouch, id), 1) | place((raw & 0x80) ? 0 : 1, offsetof(DsTouch, down), 1);
+}
+
+} // namespace dsstate
+
+// Decode a report into state; fields the report variant does not carry keep
+// their value from previous. The state is written as whole 64-bit words, so
+// the diff that follows reads them back without stalling on byte-sized
+// stores; keeping two states and alternating avoids copying one.
+template <const DsReportLayout& L>
+inline void dsDecodeState(const uint8_t* report, const DsInputState& previous, DsInputState* state) {
+    using namespace dsstate;
+    constexpr int AXIS_WORD = offsetof(DsInputState, axis) / 8;
+    constexpr int BUTTON_WORD = offsetof(DsInputState, buttons) / 8;
+    constexpr int GYRO_WORD = offsetof(DsInputState, gyro) / 8;
+    constexpr int ACCEL_WORD = offsetof(DsInputState, accel) / 8;
+    constexpr int TOUCH_WORD = offsetof(DsInputState, touch) / 8;
+
+    uint32_t battery = previous.battery;
+    uint32_t power = previous.power;
+    if constexpr (L.has(DS_FIELD_BATTERY)) {
+        // Low nibble: charge in tenths, high nibble: 0 discharging, 1 charging, 2 full
+        uint32_t raw = dsFieldRaw<L, DS_FIELD_BATTERY>(report);
+        uint32_t level = (raw & 0x0F) * 10 + 5;
+        uint32_t status = raw >> 4;
+        uint32_t plugs = dsFieldRaw<L, DS_FIELD_PLUGS>(report);
+        battery = status == 2 || level > 100 ? 100 : level;
+        power = (status == 1 ? DS_POWER_CHARGING : 0) | (status == 2 ? DS_POWER_FULL : 0) |
+                ((plugs & 0x01) ? DS_POWER_HEADPHONES : 0) | ((plugs & 0x02) ? DS_POWER_MICROPHONE : 0);
+    }
+    storeWord(state, AXIS_WORD,
+              DS_STATE_PLACE(axis[DS_AXIS_LEFT_X], dsFieldRaw<L, DS_FIELD_LEFT_X>(report)) |
+                  DS_STATE_PLACE(axis[DS_AXIS_LEFT_Y], dsFieldRaw<L, DS_FIELD_LEFT_Y>(report)) |
+                  DS_STATE_PLACE(axis[DS_AXIS_RIGHT_X], dsFieldRaw<L, DS_FIELD_RIGHT_X>(report)) |
+                  DS_STATE_PLACE(axis[DS_AXIS_RIGHT_Y], dsFieldRaw<L, DS_FIELD_RIGHT_Y>(report)) |
+                  DS_STATE_PLACE(axis[DS_AXIS_L2], dsFieldRaw<L, DS_FIELD_L2>(report)) |
+                  DS_STATE_PLACE(axis[DS_AXIS_R2], dsFieldRaw<L, DS_FIELD_R2>(report)) |
+                  DS_STATE_PLACE(battery, battery) | DS_STATE_PLACE(power, power));
+
+    uint32_t raw = dsFieldRaw<L, DS_FIELD_BUTTONS>(report) & L.buttonMask;
+    uint32_t buttons = BUTTON_TABLE.byte[0][raw & 0xFF] | BUTTON_TABLE.byte[1][(raw >> 8) & 0xFF] |
+                       BUTTON_TABLE.byte[2][(raw >> 16) & 0xFF];
+    uint32_t sensorTime = previous.sensorTime;
+    if constexpr (L.hasSensors()) {
+        sensorTime = dsFieldRaw<L, DS_FIELD_SENSOR_TIMESTAMP>(report);
+    }
+    storeWord(state, BUTTON_WORD, DS_STATE_PLACE(buttons, buttons) | DS_STATE_PLACE(sensorTime, sensorTime));
+
+    if constexpr (L.hasSensors()) {
+        uint64_t sequence = previous.sequence;
+        if constexpr (L.has(DS_FIELD_SEQUENCE)) {
+            sequence = dsFieldRaw<L, DS_FIELD_SEQUENCE>(report);
+        }
+        storeWord(state, GYRO_WORD,
+                  DS_STATE_PLACE(gyro[0], dsFieldRaw<L, DS_FIELD_GYRO_X>(report)) |
+                      DS_STATE_PLACE(gyro[1], dsFieldRaw<L, DS_FIELD_GYRO_Y>(report)) |
+                      DS_STATE_PLACE(gyro[2], dsFieldRaw<L, DS_FIELD_GYRO_Z>(report)) |
+                      DS_STATE_PLACE(sequence, sequence));
+        storeWord(state, ACCEL_WORD,
+                  DS_STATE_PLACE(accel[0], dsFieldRaw<L, DS_FIELD_ACCEL_X>(report)) |
+                      DS_STATE_PLACE(accel[1], dsFieldRaw<L, DS_FIELD_ACCEL_Y>(report)) |
+                      DS_STATE_PLACE(accel[2], dsFieldRaw<L, DS_FIELD_ACCEL_Z>(report)));
+    } else {
+        storeWord(state, GYRO_WORD, loadWord(&previous, GYRO_WORD));
+        storeWord(state, ACCEL_WORD, loadWord(&previous, ACCEL_WORD));
+    }
+    if constexpr (L.has(DS_FIELD_TOUCH_0)) {
+        storeWord(state, TOUCH_WORD, packTouch(dsFieldRaw<L, DS_FIELD_TOUCH_0>(report)));
+        storeWord(state, TOUCH_WORD + 1, packTouch(dsFieldRaw<L, DS_FIELD_TOUCH_1>(report)));
+    } else {
+        storeWord(state, TOUCH_WORD, loadWord(&previous, TOUCH_WORD));
+        storeWord(state, TOUCH_WORD + 1, loadWord(&previous, TOUCH_WORD + 1));
+    }
+}
+
+#undef DS_STATE_PLACE
+
+namespace dsstate {
+
+template <size_t... F>
+inline uint32_t changedFields(const DsInputState& previous, const DsInputState& current,
+                              std::index_sequence<F...>) {
+    return ((((loadWord(&previous, FIELD_BITS[F].word) ^ loadWord(&current, FIELD_BITS[F].word)) &
+              FIELD_BITS[F].mask) != 0 ? 1u << F : 0u) | ...);
+}
+
+template <size_t... A>
+inline uint32_t changedAxes(uint64_t axisWord, std::index_sequence<A...>) {
+    return (((axisWord & fieldBits(offsetof(DsInputState, axis) + A, 1).mask) != 0 ? 1u << A : 0u) | ...);
+}
+
+} // namespace dsstate
+
+// What changed from previous to current. Unrolled at compile time, so every
+// word is compared once in a register.
+inline DsStateDelta dsDiffState(const DsInputState& previous, const DsInputState& current) {
+    using namespace dsstate;
+    constexpr int AXIS_WORD = offsetof(DsInputState, axis) / 8;
+    DsStateDelta delta;
+    delta.fields = changedFields(previous, current, std::make_index_sequence<DS_STATE_FIELD_COUNT>());
+    delta.buttons = previous.buttons ^ current.buttons;
+    delta.axes = changedAxes(loadWord(&previous, AXIS_WORD) ^ loadWord(&current, AXIS_WORD),
+                             std::make_index_sequence<DS_AXIS_COUNT>());
+    return delta;
+}
+
+// Turn the button, stick, trigger and touch changes of a delta into samples
+// (SAMPLE_BUTTON, SAMPLE_AXIS with SDL's value ranges, SAMPLE_TOUCH). Returns
+// the number written, at most DS_MAX_DELTA_SAMPLES.
+static const int DS_MAX_DELTA_SAMPLES = 32;
+
+int dsDeltaSamples(const DsInputState& state, const DsStateDelta& delta, int32_t controller, uint64_t hostTimeUs,
+                   Sample* samples);
+
+#endif // INPUT_STATE_H
@@ -0,0 +1,20 @@
+#include "latency_probe.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+void LatencyProbe::print(const char* label) {
+    if (delays_.empty()) {
+        printf("%-8s no timestamped samples\n", label);
+        return;
+    }
+
+    uint64_t sum = 0;
+    for (uint32_t delay : delays_) {
+        sum += delay;
+    }
+    std::sort(delays_.begin(), delays_.end());
+    size_t n = delays_.size();
+    printf("%-8s %8zu samples  min %6u us  mean %8.1f us  p50 %6u us  p99 %6u us  max %6u us\n",
+           label, n, delays_[0], (double)sum / n, delays_[n / 2], delays_[n * 99 / 100], delays_[n - 1]);
+}
@@ -0,0 +1,35 @@
+#ifndef LATENCY_PROBE_H
+#define LATENCY_PROBE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Collects per-sample delivery jitter for the --compare-latency mode.
+//
+// The value for a sample is the time it reached this process minus its
+// controller timestamp mapped onto the host clock. The mapping is anchored on
+// the fastest delivery the backend itself has seen, so the value is the delay
+// on top of that backend's best case: how much the queueing and scheduling of
+// an input path varies. The constant part of the latency cancels out, so two
+// backends can be compared on jitter but not on absolute latency.
+class LatencyProbe {
+public:
+    explicit LatencyProbe(size_t maxSamples = 1 << 20) { delays_.reserve(maxSamples); }
+
+    void record(uint64_t delayUs) {
+        if (delays_.size() < delays_.capacity()) {
+            delays_.push_back(delayUs > UINT32_MAX ? UINT32_MAX : (uint32_t)delayUs);
+        }
+    }
+
+    size_t count() const { return delays_.size(); }
+
+    // min / mean / p50 / p99 / max in microseconds
+    void print(const char* label);
+
+private:
+    std::vector<uint32_t> delays_;
+};
+
+#endif // LATENCY_PROBE_H
@@ -1,190 +1,575 @@
 #include <iostream>
-#include <SDL.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <memory>
+#include <thread>
 #include <lo/lo.h> // Include the liblo library for OSC
+#include "filter_chain.h"
+#include "gesture_detector.h"
+#include "hid_backend.h"
+#include "hidraw_backend.h"
+#include "host_clock.h"
+#include "imu_resampler.h"
+#include "input_backend.h"
+#include "latency_probe.h"
+#include "orientation_fusion.h"
+#include "osc_encoder.h"
+#include "output_control.h"
+#include "osc_fanout.h"
+#include "udp_transport.h"
+#include "sample.h"
+#include "sdl_backend.h"
+#include "shm_output.h"
+#include "spsc_ring.h"
 // print bluetooth and sensor status using liblo during runtime and reactivate sensors if needed
 
-// Function to check and reactivate sensors if needed
-bool checkAndReactivateSensor(SDL_GameController* controller, SDL_SensorType sensorType, const char* sensorName, lo_address target) {
-    if (!SDL_GameControllerHasSensor(controller, sensorType)) {
-        lo_send(target, "/ps5/sensor/status", "ss", sensorName, "not supported");
-        return false;
-    }
-
-    // Check if sensor is enabled
-    if (!SDL_GameControllerIsSensorEnabled(controller, sensorType)) {
-        printf("Attempting to reactivate %s...\n", sensorName);
-        lo_send(target, "/ps5/sensor/status", "ss", sensorName, "reactivating");
-        
-        if (SDL_GameControllerSetSensorEnabled(controller, sensorType, SDL_TRUE) < 0) {
-            printf("Failed to reactivate %s: %s\n", sensorName, SDL_GetError());
-            lo_send(target, "/ps5/sensor/status", "ss", sensorName, "reactivation failed");
-            return false;
-        }
-        
-        printf("%s reactivated successfully\n", sensorName);
-        lo_send(target, "/ps5/sensor/status", "ss", sensorName, "active");
-        return true;
-    }
-    
-    return true;
+// State shared between the input backend (producer) and the OSC transmit thread (consumer)
+struct TransmitContext {
+    SpscRing<Sample>* ring;
+    OscFanout* output;
+    UdpTransport* transport;
+    SampleCounters* sensorCounters;
+    bool splitImu;    // legacy: send /ps5/gyroscope and /ps5/accelerometer instead of /ps5/imu
+    uint64_t startUs; // origin of the timestamp argument of /ps5/imu
+    OrientationFusion* fusion; // optional, sends /ps5/orientation for every fused sample
+    bool euler;       // also send /ps5/euler
+    ImuResampler* resampler; // optional, SAMPLE_IMU goes out on its uniform clock instead of as it arrives
+    FilterBank* filters;     // optional, smooths the sensors and axes before anything else sees them
+    GestureDetector* gestures; // optional, sends /ps5/gesture/* events
+    std::atomic<bool> running{true};
+};
+
+void printSampleCounters(SampleCounters& counters, const SpscRing<Sample>& ring, uint64_t elapsedMs) {
+    uint64_t delta = counters.received - counters.receivedAtLastReport;
+    double rate = elapsedMs > 0 ? delta * 1000.0 / elapsedMs : 0.0;
+    printf("Samples: received %llu, forwarded %llu (%.0f Hz) | ring: queued %zu/%zu, peak %llu, overflowed %llu\n",
+           (unsigned long long)counters.received,
+           (unsigned long long)counters.forwarded.load(),
+           rate,
+           ring.size(), ring.capacity(),
+           (unsigned long long)ring.highWater(),
+           (unsigned long long)ring.overflows());
+    counters.receivedAtLastReport = counters.received;
 }
 
-int main(int argc, char *argv[]) {
-    // Set the hint for PS5 rumble support
-    SDL_SetHint(SDL_HINT_JOYSTICK_HIDAPI_PS5_RUMBLE, "1");
-
-    // Initialize SDL
-    if (SDL_Init(SDL_INIT_GAMECONTROLLER | SDL_INIT_SENSOR) < 0) {
-        printf("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
-        return 1;
-    }
-
-    // Open the first available controller
-    SDL_GameController *controller = NULL;
-    for (int i = 0; i < SDL_NumJoysticks(); ++i) {
-        if (SDL_IsGameController(i)) {
-            controller = SDL_GameControllerOpen(i);
-            if (controller) {
-                printf("Controller opened: %s\n", SDL_GameControllerName(controller));
-                break;
+// OSC timetag for a host monotonic time
+OscTimetag hostTimetag(uint64_t hostUs) {
+    OscTimetag tag;
+    hostUsToNtp(hostUs, &tag.sec, &tag.frac);
+    return tag;
+}
+
+// Pre-serialized messages of the transmit thread; only the arguments change per sample.
+// Every message starts with the controller number (Sample::controller).
+struct OscTemplates {
+    OscMessageTemplate gyro{"/ps5/gyroscope", "ifff"};      // controller, x y z
+    OscMessageTemplate accel{"/ps5/accelerometer", "ifff"}; // controller, x y z
+    // controller, gyro x y z, accel x y z, sample time in ms since startup
+    OscMessageTemplate imu{"/ps5/imu", "iffffffd"};
+    OscMessageTemplate button{"/ps5/button", "iii"}; // controller, button, pressed
+    OscMessageTemplate axis{"/ps5/axis", "iii"};     // controller, axis, value
+    OscMessageTemplate touch{"/ps5/touch", "iiiff"}; // controller, finger, down, x and y normalised to 0..1
+    OscMessageTemplate orientation{"/ps5/orientation", "iffff"}; // controller, quaternion w x y z
+    OscMessageTemplate euler{"/ps5/euler", "ifff"};              // controller, yaw pitch roll in degrees
+    // controller, intensity, direction, sample time in ms since startup; indexed by GestureKind
+    OscMessageTemplate gesture[GESTURE_KINDS] = {
+        {"/ps5/gesture/shake", "ifid"},
+        {"/ps5/gesture/tap", "ifid"},
+        {"/ps5/gesture/flick", "ifid"},
+        {"/ps5/gesture/twist", "ifid"},
+    };
+};
+
+OscMessageTemplate& setVector(OscMessageTemplate& msg, const float* v, int first = 0) {
+    msg.setFloat(first, v[0]);
+    msg.setFloat(first + 1, v[1]);
+    msg.setFloat(first + 2, v[2]);
+    return msg;
+}
+
+// Queue the OSC messages for one sample. Sensor messages are tagged with the
+// controller's own sampling time and count sensorWeight per reading (0 for
+// resampled ones, which were counted on arrival). Returns the readings handed
+// to the transport by any flush this triggered.
+unsigned queueSample(TransmitContext* ctx, OscTemplates& osc, OscFanout& output, const Sample& sample, uint64_t nowUs,
+                     unsigned sensorWeight = 1) {
+    OscTimetag tag = hostTimetag(sample.hostTimeUs);
+    unsigned delivered = 0;
+
+    switch (sample.kind) {
+        case SAMPLE_IMU:
+            if (ctx->splitImu) {
+                osc.gyro.setInt(0, sample.controller);
+                osc.accel.setInt(0, sample.controller);
+                delivered +=
+                    output.add(setVector(osc.gyro, &sample.data[0], 1), tag, sensorWeight, nowUs, sample.controller);
+                delivered +=
+                    output.add(setVector(osc.accel, &sample.data[3], 1), tag, sensorWeight, nowUs, sample.controller);
             } else {
-                printf("Could not open controller: %s\n", SDL_GetError());
+                osc.imu.setInt(0, sample.controller);
+                for (int i = 0; i < 6; ++i) {
+                    osc.imu.setFloat(1 + i, sample.data[i]);
+                }
+                osc.imu.setDouble(7, (double)(int64_t)(sample.hostTimeUs - ctx->startUs) / 1000.0);
+                delivered += output.add(osc.imu, tag, 2 * sensorWeight, nowUs, sample.controller);
             }
-        }
+            break;
+
+        case SAMPLE_GYRO:
+            osc.gyro.setInt(0, sample.controller);
+            delivered += output.add(setVector(osc.gyro, sample.data, 1), tag, 1, nowUs, sample.controller);
+            break;
+
+        case SAMPLE_ACCEL:
+            osc.accel.setInt(0, sample.controller);
+            delivered += output.add(setVector(osc.accel, sample.data, 1), tag, 1, nowUs, sample.controller);
+            break;
+
+        case SAMPLE_BUTTON:
+            printf("Button %d %s.\n", sample.code, sample.value ? "pressed" : "released");
+            osc.button.setInt(0, sample.controller);
+            osc.button.setInt(1, sample.code);
+            osc.button.setInt(2, sample.value);
+            delivered += output.add(osc.button, tag, 0, nowUs);
+            break;
+
+        case SAMPLE_AXIS:
+            printf("Controller Axis %d: %d\n", sample.code, sample.value);
+            osc.axis.setInt(0, sample.controller);
+            osc.axis.setInt(1, sample.code);
+            osc.axis.setInt(2, sample.value);
+            delivered += output.add(osc.axis, tag, 0, nowUs, sample.controller * 16 + sample.code); // per axis
+            break;
+
+        case SAMPLE_TOUCH:
+            osc.touch.setInt(0, sample.controller);
+            osc.touch.setInt(1, sample.code);
+            osc.touch.setInt(2, sample.value);
+            osc.touch.setFloat(3, sample.data[0]);
+            osc.touch.setFloat(4, sample.data[1]);
+            delivered += output.add(osc.touch, tag, 0, nowUs);
+            break;
     }
 
-    if (controller == NULL) {
-        printf("No controller detected!\n");
-        SDL_Quit();
-        return 1;
+    // Orientation at the sensor rate, stamped like the sample it came from
+    if (ctx->fusion && ctx->fusion->add(sample)) {
+        const Quaternion& q = ctx->fusion->orientation(sample.controller);
+        osc.orientation.setInt(0, sample.controller);
+        osc.orientation.setFloat(1, q.w);
+        osc.orientation.setFloat(2, q.x);
+        osc.orientation.setFloat(3, q.y);
+        osc.orientation.setFloat(4, q.z);
+        delivered += output.add(osc.orientation, tag, 0, nowUs, sample.controller);
+        if (ctx->euler) {
+            float angles[3];
+            quaternionToEuler(q, angles);
+            osc.euler.setInt(0, sample.controller);
+            delivered += output.add(setVector(osc.euler, angles, 1), tag, 0, nowUs, sample.controller);
+        }
     }
 
-    // Enable sensors (Accelerometer and Gyroscope)
-    bool accelEnabled = false, gyroEnabled = false;
-    if (SDL_GameControllerHasSensor(controller, SDL_SENSOR_ACCEL)) {
-        if (SDL_GameControllerSetSensorEnabled(controller, SDL_SENSOR_ACCEL, SDL_TRUE) < 0) {
-            printf("Failed to enable accelerometer: %s\n", SDL_GetError());
-        } else {
-            accelEnabled = true;
-            printf("Accelerometer enabled.\n");
+    // Gestures the sample completed, as discrete events
+    if (ctx->gestures) {
+        Gesture gestures[GESTURE_KINDS];
+        int count = ctx->gestures->add(sample, gestures);
+        for (int i = 0; i < count; ++i) {
+            const Gesture& gesture = gestures[i];
+            OscMessageTemplate& msg = osc.gesture[gesture.kind];
+            printf("Gesture %s: controller %d, intensity %.2f, direction %d\n", msg.address(), gesture.controller,
+                   gesture.intensity, gesture.direction);
+            msg.setInt(0, gesture.controller);
+            msg.setFloat(1, gesture.intensity);
+            msg.setInt(2, gesture.direction);
+            msg.setDouble(3, (double)(int64_t)(gesture.hostTimeUs - ctx->startUs) / 1000.0);
+            delivered += output.add(msg, tag, 0, nowUs);
         }
-    } else {
-        printf("Accelerometer is NOT supported.\n");
     }
+    return delivered;
+}
 
-    if (SDL_GameControllerHasSensor(controller, SDL_SENSOR_GYRO)) {
-        if (SDL_GameControllerSetSensorEnabled(controller, SDL_SENSOR_GYRO, SDL_TRUE) < 0) {
-            printf("Failed to enable gyroscope: %s\n", SDL_GetError());
-        } else {
-            gyroEnabled = true;
-            printf("Gyroscope enabled.\n");
+// Transmit thread: drains the ring and performs all console and OSC output,
+// so a slow stdout or network stack never delays the next controller read
+void transmitLoop(TransmitContext* ctx) {
+    OscTemplates osc;
+    OscFanout& output = *ctx->output;
+    Sample sample;
+    for (;;) {
+        while (ctx->ring->tryPop(sample)) {
+            Sample filteredAxes[FilterConfig::AXIS_LANES];
+            int axisCount = 0;
+            if (ctx->filters && !ctx->filters->process(sample, filteredAxes, &axisCount)) {
+                continue; // a filtered axis goes out with the next IMU sample
+            }
+            if (ctx->resampler && sample.kind == SAMPLE_IMU) {
+                ctx->resampler->add(sample);
+                ctx->sensorCounters->forwarded += 2;
+            } else {
+                ctx->sensorCounters->forwarded += queueSample(ctx, osc, output, sample, hostMonotonicUs());
+            }
+            for (int a = 0; a < axisCount; ++a) {
+                ctx->sensorCounters->forwarded += queueSample(ctx, osc, output, filteredAxes[a], hostMonotonicUs());
+            }
+        }
+
+        uint64_t now = hostMonotonicUs();
+        if (ctx->resampler) {
+            Sample resampled;
+            while (ctx->resampler->next(now, &resampled)) {
+                ctx->sensorCounters->forwarded += queueSample(ctx, osc, output, resampled, now, 0);
+            }
+        }
+        ctx->sensorCounters->forwarded += output.flushIfDue(now);
+
+        // One system call for every datagram produced in this iteration
+        ctx->transport->flush();
+
+        if (!ctx->running.load()) {
+            break;
+        }
+
+        // Sleep until more data arrives or the pending batch is due
+        uint64_t waitUs = 100000;
+        if (output.pending()) {
+            waitUs = output.deadlineUs() > now ? output.deadlineUs() - now : 0;
+        }
+        if (ctx->resampler && ctx->resampler->deadlineUs() != UINT64_MAX) {
+            uint64_t untilDue = ctx->resampler->deadlineUs() > now ? ctx->resampler->deadlineUs() - now : 0;
+            waitUs = untilDue < waitUs ? untilDue : waitUs;
+        }
+        if (waitUs > 0) {
+            ctx->ring->waitForData(std::chrono::microseconds(waitUs));
         }
-    } else {
-        printf("Gyroscope is NOT supported.\n");
     }
 
-    // Set up OSC target
-    lo_address target = lo_address_new("127.0.0.1", "7400");
-    
-    // Status monitoring variables
-    Uint32 lastStatusCheck = 0;
-    const Uint32 STATUS_CHECK_INTERVAL = 1000; // Check status every 1 second
-    bool wasConnected = true;
+    ctx->sensorCounters->forwarded += output.flush();
+    ctx->transport->flush();
+    output.printStats();
+    ctx->transport->printStats();
+}
+
+// Set from SIGINT/SIGTERM; installed before SDL so the HID backend stops cleanly too
+static std::atomic<bool> quitRequested{false};
+
+static void requestQuit(int) {
+    quitRequested = true;
+}
+
+static const uint64_t STATUS_CHECK_INTERVAL_US = 1000000; // Check status every 1 second
+
+// Command line settings of the input backends
+struct BackendOptions {
+    AcquisitionMode sdlMode = ACQUIRE_EVENTS;
+    bool hidNewestOnly = false;
+    const char* hidrawReplay = NULL;
+    const char* hidrawRecord = NULL;
+    bool hidrawIoUring = false;
+    lo_address statusTarget = NULL;
+};
+
+std::unique_ptr<InputBackend> createBackend(const char* name, SampleSink& sink, const BackendOptions& options) {
+    if (strcmp(name, "sdl") == 0) {
+        return std::unique_ptr<InputBackend>(new SdlBackend(sink, options.sdlMode, options.statusTarget));
+    }
+    if (strcmp(name, "hid") == 0) {
+        return std::unique_ptr<InputBackend>(new HidBackend(sink, options.hidNewestOnly));
+    }
+#ifdef __linux__
+    if (strcmp(name, "hidraw") == 0) {
+        HidrawBackend::Options hidraw;
+        hidraw.replaySource = options.hidrawReplay;
+        hidraw.recordPath = options.hidrawRecord;
+        hidraw.useIoUring = options.hidrawIoUring;
+        return std::unique_ptr<InputBackend>(new HidrawBackend(sink, hidraw));
+    }
+#endif
+    return nullptr;
+}
 
-    // Main loop
-    SDL_Event event;
+// Pump a backend until it stops, a quit is requested or runUs has passed (0 = no limit)
+void runBackend(InputBackend& backend, SampleCounters& counters, const SpscRing<Sample>& ring, uint64_t runUs) {
+    uint64_t startUs = hostMonotonicUs();
+    uint64_t lastStatusCheck = startUs;
     bool running = true;
 
-    while (running) {
-        Uint32 currentTime = SDL_GetTicks();
-        
+    while (running && !quitRequested.load()) {
+        uint64_t now = hostMonotonicUs();
+        if (runUs > 0 && now - startUs >= runUs) {
+            break;
+        }
+
         // Regular status check
-        if (currentTime - lastStatusCheck >= STATUS_CHECK_INTERVAL) {
-            lastStatusCheck = currentTime;
-            
-            // Check Bluetooth connection status
-            bool isConnected = SDL_GameControllerGetAttached(controller);
-            if (isConnected != wasConnected) {
-                const char* status = isConnected ? "connected" : "disconnected";
-                printf("Controller %s\n", status);
-                lo_send(target, "/ps5/bluetooth/status", "s", status);
-                wasConnected = isConnected;
+        if (now - lastStatusCheck >= STATUS_CHECK_INTERVAL_US) {
+            printSampleCounters(counters, ring, (now - lastStatusCheck) / 1000);
+            lastStatusCheck = now;
+            backend.checkStatus();
+        }
+
+        // Block for input, but wake up in time for the status check
+        uint64_t untilCheck = lastStatusCheck + STATUS_CHECK_INTERVAL_US - now;
+        running = backend.pump((int)((untilCheck + 999) / 1000));
+    }
+    printSampleCounters(counters, ring, (hostMonotonicUs() - lastStatusCheck) / 1000);
+}
+
+int main(int argc, char *argv[]) {
+    BackendOptions backendOptions;
+    const char* backendName = "sdl";
+    double compareSeconds = 0.0;
+    size_t ringSize = 1024;
+    bool splitImu = false;
+    double batchWindowMs = 0.0;
+    size_t batchMaxBytes = 1400; // stay below a typical path MTU
+    OscDestinationConfig destinations[UdpTransport::MAX_DESTINATIONS];
+    int destinationCount = 0;
+    const char* shmName = NULL;
+    uint32_t shmSize = 4096;
+    const char* listenPort = NULL;
+    double outputRate = 100.0;
+    const char* fusionName = NULL;
+    double fusionGain = -1.0; // the algorithm's default
+    bool euler = false;
+    double resampleRate = 0.0;
+    double resampleDelayMs = 10.0;
+    ResampleInterpolation interpolation = RESAMPLE_LINEAR;
+    FilterConfig filterConfig;
+    int filterCount = 0;
+    double filterRate = 250.0;
+    bool gestures = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--poll") == 0) {
+            backendOptions.sdlMode = ACQUIRE_POLL;
+        } else if (strcmp(argv[i], "--events") == 0) {
+            backendOptions.sdlMode = ACQUIRE_EVENTS;
+        } else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            backendName = argv[++i];
+        } else if (strcmp(argv[i], "--hid-latest") == 0) {
+            backendOptions.hidNewestOnly = true;
+        } else if (strcmp(argv[i], "--hidraw-replay") == 0 && i + 1 < argc) {
+            backendOptions.hidrawReplay = argv[++i];
+        } else if (strcmp(argv[i], "--hidraw-record") == 0 && i + 1 < argc) {
+            backendOptions.hidrawRecord = argv[++i];
+        } else if (strcmp(argv[i], "--hidraw-uring") == 0) {
+            backendOptions.hidrawIoUring = true;
+        } else if (strcmp(argv[i], "--compare-latency") == 0 && i + 1 < argc) {
+            compareSeconds = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--split") == 0) {
+            splitImu = true;
+        } else if (strcmp(argv[i], "--dest") == 0 && i + 1 < argc) {
+            if (destinationCount == UdpTransport::MAX_DESTINATIONS) {
+                printf("Too many --dest options, at most %d destinations\n", UdpTransport::MAX_DESTINATIONS);
+                return 1;
+            }
+            if (!parseOscDestination(argv[++i], &destinations[destinationCount++])) {
+                printf("Invalid destination '%s', expected HOST:PORT[:RATE[:FILTER]]\n", argv[i]);
+                return 1;
             }
-            
-            if (isConnected) {
-                // Check and reactivate sensors if needed
-                checkAndReactivateSensor(controller, SDL_SENSOR_ACCEL, "accelerometer", target);
-                checkAndReactivateSensor(controller, SDL_SENSOR_GYRO, "gyroscope", target);
+        } else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc) {
+            shmName = argv[++i];
+        } else if (strcmp(argv[i], "--shm-size") == 0 && i + 1 < argc) {
+            shmSize = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--batch-window") == 0 && i + 1 < argc) {
+            batchWindowMs = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--batch-bytes") == 0 && i + 1 < argc) {
+            batchMaxBytes = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+            listenPort = argv[++i];
+        } else if (strcmp(argv[i], "--output-rate") == 0 && i + 1 < argc) {
+            outputRate = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--fusion") == 0 && i + 1 < argc) {
+            fusionName = argv[++i];
+        } else if (strcmp(argv[i], "--fusion-gain") == 0 && i + 1 < argc) {
+            fusionGain = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--euler") == 0) {
+            euler = true;
+        } else if (strcmp(argv[i], "--resample") == 0 && i + 1 < argc) {
+            resampleRate = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--resample-delay") == 0 && i + 1 < argc) {
+            resampleDelayMs = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--cubic") == 0) {
+            interpolation = RESAMPLE_CUBIC;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            FilterSpec filter;
+            if (!parseFilterSpec(argv[++i], &filter)) {
+                printf("Invalid filter '%s', expected CHANNELS:median|deadzone|lowpass|highpass|one_euro:P1[:P2[:P3]]\n",
+                       argv[i]);
+                return 1;
             }
+            filterConfig.add(filter);
+            filterCount++;
+        } else if (strcmp(argv[i], "--filter-rate") == 0 && i + 1 < argc) {
+            filterRate = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--gestures") == 0) {
+            gestures = true;
+        } else if (strcmp(argv[i], "--ring-size") == 0 && i + 1 < argc) {
+            ringSize = strtoul(argv[++i], NULL, 10);
+        } else {
+            printf("Usage: %s [--backend sdl|hid|hidraw] [--events | --poll] [--hid-latest] [--compare-latency SECONDS]\n"
+                   "       [--hidraw-replay PATH|-|fd:N] [--hidraw-record PATH] [--hidraw-uring] [--split]\n"
+                   "       [--dest HOST:PORT[:RATE[:FILTER]] ...] [--batch-window MS] [--batch-bytes N]\n"
+                   "       [--ring-size N] [--shm NAME] [--shm-size N] [--listen PORT] [--output-rate HZ]\n"
+                   "       [--fusion madgwick|mahony] [--fusion-gain G] [--euler]\n"
+                   "       [--resample HZ] [--resample-delay MS] [--cubic]\n"
+                   "       [--filter CHANNELS:KIND:P1[:P2[:P3]] ...] [--filter-rate HZ] [--gestures]\n", argv[0]);
+            return 1;
         }
+    }
 
-        // Poll events
-        while (SDL_PollEvent(&event)) {
-            switch (event.type) {
-                case SDL_QUIT:
-                    running = false;
-                    break;
-
-                case SDL_CONTROLLERBUTTONDOWN:
-                    printf("Button %d pressed.\n", event.cbutton.button);
-                    break;
+    signal(SIGINT, requestQuit);
+    signal(SIGTERM, requestQuit);
 
-                case SDL_CONTROLLERBUTTONUP:
-                    printf("Button %d released.\n", event.cbutton.button);
-                    break;
+    // Set up OSC targets: raw UDP sockets for the transmit thread, liblo for status messages
+    // from the acquisition thread, which go to the first destination only
+    if (destinationCount == 0) {
+        parseOscDestination("127.0.0.1:7400", &destinations[destinationCount++]);
+    }
+    UdpTransport transport;
+    OscFanout output(transport, batchWindowMs > 0 ? (uint64_t)(batchWindowMs * 1000.0) : 0, batchMaxBytes);
+    for (int i = 0; i < destinationCount; ++i) {
+        if (!output.addDestination(destinations[i])) {
+            return 1;
+        }
+        printf("OSC destination %s:%s, %s, filter '%s'\n", destinations[i].host, destinations[i].port,
+               destinations[i].maxRate > 0 ? "rate limited" : "unlimited",
+               destinations[i].filter[0] ? destinations[i].filter : "*");
+    }
 
-                case SDL_CONTROLLERAXISMOTION:
-                    printf("Controller Axis %d: %d\n", event.caxis.axis, event.caxis.value);
-                    break;
+    // Optional shared-memory stream for same-host consumers (see ps5_shm.h)
+    ShmOutput shm;
+    if (shmName) {
+        if (!shm.open(shmName, shmSize)) {
+            return 1;
+        }
+        printf("Shared memory stream: %s\n", shmName);
+    }
 
-                case SDL_CONTROLLERDEVICEREMOVED:
-                    printf("Controller removed.\n");
-                    running = false;
-                    break;
+    // Rumble, light and trigger commands, coalesced into at most outputRate output reports per second
+    OutputControl outputControl;
+    if (listenPort) {
+        if (!outputControl.listen(listenPort)) {
+            return 1;
+        }
+        outputControl.setMaxRate(outputRate);
+        printf("Output reports: at most %.0f per second\n", outputRate);
+    }
 
-                default:
-                    break;
-            }
+    // Optional orientation from gyro and accel, one filter per controller on the transmit thread
+    std::unique_ptr<OrientationFusion> fusion;
+    if (fusionName) {
+        FusionAlgorithm algorithm;
+        if (strcmp(fusionName, "madgwick") == 0) {
+            algorithm = FUSION_MADGWICK;
+        } else if (strcmp(fusionName, "mahony") == 0) {
+            algorithm = FUSION_MAHONY;
+        } else {
+            printf("Unknown fusion '%s', expected madgwick or mahony\n", fusionName);
+            return 1;
         }
+        float gain = fusionGain >= 0 ? (float)fusionGain : OrientationFilter::defaultGain(algorithm);
+        fusion.reset(new OrientationFusion(algorithm, gain));
+        printf("Orientation: %s, gain %.3f, /ps5/orientation%s\n", fusionName, gain, euler ? " and /ps5/euler" : "");
+    }
 
-        // Check for accelerometer data
-        if (accelEnabled) {
-            float accel[3] = {0};
-            if (SDL_GameControllerGetSensorData(controller, SDL_SENSOR_ACCEL, accel, 3) == 0) {
-                // printf("Accelerometer - X: %.2f, Y: %.2f, Z: %.2f\n", accel[0], accel[1], accel[2]);
-            } else {
-                // Log error only once per loop iteration
-                static bool accelErrorLogged = false;
-                if (!accelErrorLogged) {
-                    printf("Failed to read accelerometer data: %s\n", SDL_GetError());
-                    lo_send(target, "/ps5/sensor/error", "ss", "accelerometer", SDL_GetError());
-                    accelErrorLogged = true;
-                }
-            }
+    lo_address statusTarget = lo_address_new(destinations[0].host, destinations[0].port);
+    backendOptions.statusTarget = statusTarget;
+    SampleCounters sensorCounters;
+
+    // Start the transmit thread; this thread only reads the controller from here on
+    SpscRing<Sample> ring(ringSize);
+    TransmitContext transmit;
+    transmit.ring = &ring;
+    transmit.output = &output;
+    transmit.transport = &transport;
+    transmit.sensorCounters = &sensorCounters;
+    transmit.splitImu = splitImu;
+    transmit.startUs = hostMonotonicUs();
+    transmit.fusion = fusion.get();
+    transmit.euler = euler;
+    std::unique_ptr<ImuResampler> resampler;
+    if (resampleRate > 0) {
+        resampler.reset(new ImuResampler(resampleRate, (uint64_t)(resampleDelayMs * 1000.0), interpolation,
+                                         transmit.startUs));
+        printf("Resampling /ps5/imu to %.0f Hz, %s interpolation, %.1f ms behind the input\n", resampleRate,
+               interpolation == RESAMPLE_CUBIC ? "cubic" : "linear", resampleDelayMs);
+    }
+    transmit.resampler = resampler.get();
+    std::unique_ptr<FilterBank> filters;
+    if (filterCount > 0) {
+        if (!(filterRate > 0) || !filterConfig.prepare(filterRate)) {
+            printf("Invalid filters: every cutoff must be below half the filter rate of %.0f Hz\n", filterRate);
+            return 1;
         }
+        filters.reset(new FilterBank(filterConfig, filterRate));
+        printf("Filters: %d, coefficients for %.0f Hz\n", filterCount, filterRate);
+    }
+    transmit.filters = filters.get();
+    std::unique_ptr<GestureDetector> gestureDetector;
+    if (gestures) {
+        gestureDetector.reset(new GestureDetector());
+        printf("Gestures: /ps5/gesture/shake, tap, flick and twist\n");
+    }
+    transmit.gestures = gestureDetector.get();
+    std::thread transmitThread(transmitLoop, &transmit);
+    printf("Sample ring capacity: %zu\n", ring.capacity());
+    printf("OSC batching: %.2f ms window, %zu byte budget\n", batchWindowMs, batchMaxBytes);
 
-        // Check for gyroscope data
-        if (gyroEnabled) {
-            float gyro[3] = {0};
-            if (SDL_GameControllerGetSensorData(controller, SDL_SENSOR_GYRO, gyro, 3) == 0) {
-                // Send data via OSC
-                lo_send(target, "/ps5/gyroscope", "fff", gyro[0], gyro[1], gyro[2]);
-            } else {
-                static bool gyroErrorLogged = false;
-                if (!gyroErrorLogged) {
-                    printf("Failed to read gyroscope data: %s\n", SDL_GetError());
-                    lo_send(target, "/ps5/sensor/error", "ss", "gyroscope", SDL_GetError());
-                    gyroErrorLogged = true;
-                }
+    SampleSink sink;
+    sink.ring = &ring;
+    sink.shm = shmName ? &shm : NULL;
+    sink.counters = &sensorCounters;
+    sink.status = statusTarget;
+    sink.output = listenPort ? &outputControl : NULL;
+
+    int status = 0;
+    if (compareSeconds > 0) {
+        // Run every backend in turn on the same controller and compare their delivery jitter; each is
+        // measured against its own fastest delivery, so this says nothing about absolute latency
+        const char* names[] = {"sdl", "hid"};
+        LatencyProbe probes[2];
+        for (int i = 0; i < 2 && !quitRequested.load(); ++i) {
+            std::unique_ptr<InputBackend> backend = createBackend(names[i], sink, backendOptions);
+            printf("Jitter comparison: %s backend for %.0f s\n", names[i], compareSeconds);
+            if (!backend->open()) {
+                continue;
             }
+            sink.latency = &probes[i];
+            runBackend(*backend, sensorCounters, ring, (uint64_t)(compareSeconds * 1000000.0));
+            backend->close();
+        }
+        sink.latency = NULL;
+        printf("Per-sample jitter, the delay above the fastest delivery of the same backend (not absolute latency):\n");
+        for (int i = 0; i < 2; ++i) {
+            probes[i].print(names[i]);
         }
+    } else {
+        std::unique_ptr<InputBackend> backend = createBackend(backendName, sink, backendOptions);
+        if (!backend) {
+            printf("Unknown backend '%s', expected sdl, hid or hidraw (Linux)\n", backendName);
+            status = 1;
+        } else if (!backend->open()) {
+            status = 1;
+        } else {
+            printf("Input backend: %s\n", backend->name());
+            printf("Sensor output: %s\n", backend->pairsImu() && !splitImu ? "/ps5/imu" : "/ps5/gyroscope, /ps5/accelerometer");
+            runBackend(*backend, sensorCounters, ring, 0);
+            backend->printStats();
+            backend->close();
+        }
+    }
+
+    // Let the transmit thread drain what is left, then stop it
+    transmit.running = false;
+    ring.wake();
+    transmitThread.join();
 
-        SDL_Delay(100);  // Delay to reduce CPU usage
+    if (shmName) {
+        printf("Shared memory: %llu records published\n", (unsigned long long)shm.published());
     }
+    outputControl.printStats();
 
     // Clean up
-    SDL_GameControllerClose(controller);
-    SDL_Quit();
-    return 0;
+    lo_address_free(statusTarget);
+    return status;
 }
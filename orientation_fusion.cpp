@@ -0,0 +1,171 @@
+#include "orientation_fusion.h"
+
+#include <math.h>
+
+static const float RADIANS_TO_DEGREES = 180.0f / 3.14159265f;
+
+static inline float inverseLength(float a, float b, float c) {
+    return 1.0f / sqrtf(a * a + b * b + c * c);
+}
+
+static inline float inverseLength(float a, float b, float c, float d) {
+    return 1.0f / sqrtf(a * a + b * b + c * c + d * d);
+}
+
+void OrientationFilter::update(const float* gyro, const float* accel, float dt) {
+    // SDL frame (X right, Y up, Z towards the player) to the Z-up filter frame
+    float gx = gyro[0], gy = -gyro[2], gz = gyro[1];
+    float ax = accel[0], ay = -accel[2], az = accel[1];
+
+    // Without a gravity reference (all zero) the gyro is integrated alone
+    if (ax != 0.0f || ay != 0.0f || az != 0.0f) {
+        float n = inverseLength(ax, ay, az);
+        ax *= n;
+        ay *= n;
+        az *= n;
+        if (!aligned_) {
+            align(ax, ay, az);
+            return;
+        }
+    }
+
+    if (algorithm_ == FUSION_MADGWICK) {
+        updateMadgwick(gx, gy, gz, ax, ay, az, dt);
+    } else {
+        updateMahony(gx, gy, gz, ax, ay, az, dt);
+    }
+}
+
+// The rotation that takes the measured up direction to Z, without yaw
+void OrientationFilter::align(float ax, float ay, float az) {
+    aligned_ = true;
+    if (az < -0.9999f) {
+        q_ = Quaternion{0.0f, 1.0f, 0.0f, 0.0f}; // upside down
+        return;
+    }
+    // Half-way quaternion between a and Z: (1 + a.Z, a x Z), normalised
+    float w = 1.0f + az;
+    float n = inverseLength(w, ay, ax);
+    q_ = Quaternion{w * n, ay * n, -ax * n, 0.0f};
+}
+
+// Madgwick, "An efficient orientation filter for inertial and inertial/magnetic
+// sensor arrays" (2010), IMU variant; the accel is already normalised or zero
+void OrientationFilter::updateMadgwick(float gx, float gy, float gz, float ax, float ay, float az, float dt) {
+    float q0 = q_.w, q1 = q_.x, q2 = q_.y, q3 = q_.z;
+
+    // Rate of change from the gyro
+    float qDot0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+    float qDot1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+    float qDot2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+    float qDot3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+    if (ax != 0.0f || ay != 0.0f || az != 0.0f) {
+        // Gradient of the error between gravity as estimated and as measured
+        float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+        float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+        float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+        float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+        float s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+        float s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+        float s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+        float s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+        float sNorm = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+        if (sNorm > 0.0f) {
+            float step = gain_ / sqrtf(sNorm);
+            qDot0 -= step * s0;
+            qDot1 -= step * s1;
+            qDot2 -= step * s2;
+            qDot3 -= step * s3;
+        }
+    }
+
+    q0 += qDot0 * dt;
+    q1 += qDot1 * dt;
+    q2 += qDot2 * dt;
+    q3 += qDot3 * dt;
+    float n = inverseLength(q0, q1, q2, q3);
+    q_ = Quaternion{q0 * n, q1 * n, q2 * n, q3 * n};
+}
+
+// Mahony et al., "Nonlinear complementary filters on the special orthogonal
+// group" (2008), proportional term only; gyro bias is left to the caller
+void OrientationFilter::updateMahony(float gx, float gy, float gz, float ax, float ay, float az, float dt) {
+    float q0 = q_.w, q1 = q_.x, q2 = q_.y, q3 = q_.z;
+
+    if (ax != 0.0f || ay != 0.0f || az != 0.0f) {
+        // Half of the estimated gravity direction, and its cross product with the measured one
+        float halfVx = q1 * q3 - q0 * q2;
+        float halfVy = q0 * q1 + q2 * q3;
+        float halfVz = q0 * q0 - 0.5f + q3 * q3;
+        float halfEx = ay * halfVz - az * halfVy;
+        float halfEy = az * halfVx - ax * halfVz;
+        float halfEz = ax * halfVy - ay * halfVx;
+        gx += 2.0f * gain_ * halfEx;
+        gy += 2.0f * gain_ * halfEy;
+        gz += 2.0f * gain_ * halfEz;
+    }
+
+    gx *= 0.5f * dt;
+    gy *= 0.5f * dt;
+    gz *= 0.5f * dt;
+    float qa = q0, qb = q1, qc = q2;
+    q0 += -qb * gx - qc * gy - q3 * gz;
+    q1 += qa * gx + qc * gz - q3 * gy;
+    q2 += qa * gy - qb * gz + q3 * gx;
+    q3 += qa * gz + qb * gy - qc * gx;
+    float n = inverseLength(q0, q1, q2, q3);
+    q_ = Quaternion{q0 * n, q1 * n, q2 * n, q3 * n};
+}
+
+void quaternionToEuler(const Quaternion& q, float* yawPitchRoll) {
+    float sinRoll = 2.0f * (q.w * q.y - q.x * q.z);
+    sinRoll = sinRoll > 1.0f ? 1.0f : (sinRoll < -1.0f ? -1.0f : sinRoll);
+    yawPitchRoll[0] = atan2f(q.x * q.y + q.w * q.z, 0.5f - q.y * q.y - q.z * q.z) * RADIANS_TO_DEGREES;
+    yawPitchRoll[1] = atan2f(q.w * q.x + q.y * q.z, 0.5f - q.x * q.x - q.y * q.y) * RADIANS_TO_DEGREES;
+    yawPitchRoll[2] = asinf(sinRoll) * RADIANS_TO_DEGREES;
+}
+
+OrientationFusion::OrientationFusion(FusionAlgorithm algorithm, float gain) {
+    for (Controller& controller : controllers_) {
+        controller.filter = OrientationFilter(algorithm);
+        controller.filter.setGain(gain);
+    }
+}
+
+bool OrientationFusion::update(Controller& controller, const float* gyro, uint64_t timeUs) {
+    uint64_t step = timeUs - controller.lastUs;
+    bool restart = controller.lastUs == 0 || timeUs <= controller.lastUs || step > MAX_STEP_US;
+    controller.lastUs = timeUs;
+    if (restart) {
+        return false;
+    }
+    controller.filter.update(gyro, controller.accel, (float)step * 1e-6f);
+    return true;
+}
+
+bool OrientationFusion::add(const Sample& sample) {
+    if (sample.controller < 0 || sample.controller >= MAX_CONTROLLERS) {
+        return false;
+    }
+    Controller& controller = controllers_[sample.controller];
+    uint64_t timeUs = sample.timestampUs != 0 ? sample.timestampUs : sample.hostTimeUs;
+
+    switch (sample.kind) {
+        case SAMPLE_IMU:
+            controller.accel[0] = sample.data[3];
+            controller.accel[1] = sample.data[4];
+            controller.accel[2] = sample.data[5];
+            return update(controller, &sample.data[0], timeUs);
+        case SAMPLE_GYRO:
+            return update(controller, sample.data, timeUs);
+        case SAMPLE_ACCEL:
+            controller.accel[0] = sample.data[0];
+            controller.accel[1] = sample.data[1];
+            controller.accel[2] = sample.data[2];
+            return false;
+        default:
+            return false;
+    }
+}
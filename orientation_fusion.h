@@ -0,0 +1,88 @@
+#ifndef ORIENTATION_FUSION_H
+#define ORIENTATION_FUSION_H
+
+#include <stdint.h>
+#include "sample.h"
+
+enum FusionAlgorithm : uint8_t {
+    FUSION_MADGWICK, // gradient descent step towards gravity; gain is beta
+    FUSION_MAHONY,   // proportional feedback of the gravity error; gain is Kp
+};
+
+// Unit quaternion, the controller's orientation in the earth frame
+struct Quaternion {
+    float w = 1.0f;
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+};
+
+// Orientation of one controller from its gyro and accelerometer.
+//
+// The filter works in a Z-up frame: X to the right of the controller, Y away
+// from the player, Z up out of the touchpad. update() takes the sensors in the
+// SDL frame of the samples (Y up, Z towards the player) and remaps them.
+// The accelerometer pulls the estimate towards gravity with the gain, so
+// pitch and roll cannot drift; yaw has no reference and drifts with the gyro
+// bias. A higher gain follows the accelerometer faster but lets hand
+// movement tilt the estimate.
+class OrientationFilter {
+public:
+    static float defaultGain(FusionAlgorithm algorithm) { return algorithm == FUSION_MADGWICK ? 0.1f : 0.5f; }
+
+    explicit OrientationFilter(FusionAlgorithm algorithm = FUSION_MADGWICK)
+        : algorithm_(algorithm), gain_(defaultGain(algorithm)) {}
+
+    void setGain(float gain) { gain_ = gain; }
+
+    // gyro in rad/s, accel in any unit (only its direction is used), dt in seconds.
+    // The first update with an accelerometer reading sets pitch and roll from it directly.
+    void update(const float* gyro, const float* accel, float dt);
+
+    const Quaternion& orientation() const { return q_; }
+
+private:
+    void updateMadgwick(float gx, float gy, float gz, float ax, float ay, float az, float dt);
+    void updateMahony(float gx, float gy, float gz, float ax, float ay, float az, float dt);
+    void align(float ax, float ay, float az);
+
+    FusionAlgorithm algorithm_;
+    float gain_;
+    bool aligned_ = false;
+    Quaternion q_;
+};
+
+// Yaw (about up, turning left is positive), pitch (nose up) and roll (right
+// side down) in degrees
+void quaternionToEuler(const Quaternion& q, float* yawPitchRoll);
+
+// One OrientationFilter per controller, fed with the samples of the transmit
+// thread. The time step comes from the controller's sensor timestamps (host
+// time without them); steps over MAX_STEP_US, such as after a reconnect,
+// only restart the clock. Backends that deliver gyro and accel separately are
+// fused on every gyro sample with the latest accel.
+class OrientationFusion {
+public:
+    static const int MAX_CONTROLLERS = 8;
+    static const uint64_t MAX_STEP_US = 100000;
+
+    OrientationFusion(FusionAlgorithm algorithm, float gain);
+
+    // Feed one sample; true if it updated the orientation of its controller
+    bool add(const Sample& sample);
+
+    const Quaternion& orientation(int32_t controller) const { return controllers_[controller].filter.orientation(); }
+
+private:
+    struct Controller {
+        OrientationFilter filter;
+        float accel[3] = {0.0f, 0.0f, 0.0f};
+        uint64_t lastUs = 0;
+    };
+
+    bool update(Controller& controller, const float* gyro, uint64_t timeUs);
+
+    Controller controllers_[MAX_CONTROLLERS];
+};
+
+#endif // ORIENTATION_FUSION_H
@@ -0,0 +1,55 @@
+#include "osc_batcher.h"
+
+// Room for one maximum-size message in its own nested bundle on top of the budget
+static const size_t WRITER_SLACK = 16 + 4 + 16 + 4 + OscMessageTemplate::MAX_SIZE;
+
+OscBatcher::OscBatcher(UdpTransport& transport, uint32_t destinations, uint64_t windowUs, size_t maxBytes)
+    : transport_(transport), destinations_(destinations), windowUs_(windowUs), maxBytes_(maxBytes),
+      writer_(maxBytes + WRITER_SLACK) {}
+
+unsigned OscBatcher::add(const OscMessageTemplate& msg, OscTimetag tag, unsigned weight, uint64_t nowUs) {
+    // Keep the datagram within budget: send what we have before this message
+    unsigned delivered = 0;
+    if (!writer_.empty() && writer_.size() + writer_.bytesNeeded(msg, tag) > maxBytes_) {
+        delivered += flush();
+    }
+
+    if (writer_.empty()) {
+        deadlineUs_ = nowUs + windowUs_;
+    }
+    writer_.add(msg, tag);
+    weight_ += weight;
+
+    if (windowUs_ == 0 || writer_.size() >= maxBytes_) {
+        delivered += flush();
+    }
+    return delivered;
+}
+
+unsigned OscBatcher::flushIfDue(uint64_t nowUs) {
+    if (!writer_.empty() && nowUs >= deadlineUs_) {
+        return flush();
+    }
+    return 0;
+}
+
+unsigned OscBatcher::flush() {
+    if (writer_.empty()) {
+        return 0;
+    }
+
+    unsigned delivered = 0;
+    size_t length;
+    const uint8_t* datagram = writer_.finish(&length);
+    if (transport_.queue(datagram, length, destinations_)) {
+        bundlesSent_++;
+        messagesSent_ += writer_.messages();
+        delivered = weight_;
+    } else {
+        sendErrors_++;
+    }
+
+    writer_.reset();
+    weight_ = 0;
+    return delivered;
+}
@@ -0,0 +1,60 @@
+#ifndef OSC_BATCHER_H
+#define OSC_BATCHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "osc_encoder.h"
+#include "udp_transport.h"
+
+// Collects OSC messages and queues them on the transport as one bundle
+// datagram per flush window, for the destinations in a bit mask.
+//
+// Every message keeps its own timetag: messages sharing a timetag go into one
+// nested bundle, and the outer bundle is tagged "immediately". A window of 0
+// sends each message as soon as it is added. The batch is also flushed early
+// once it would grow beyond the byte budget. Messages are copied out of their
+// templates into a buffer allocated once, so batching never touches the heap.
+//
+// add() and flush() return how many sensor readings (the weight passed to
+// add()) were handed to the transport by a flush they triggered.
+class OscBatcher {
+public:
+    OscBatcher(UdpTransport& transport, uint32_t destinations, uint64_t windowUs, size_t maxBytes);
+
+    OscBatcher(const OscBatcher&) = delete;
+    OscBatcher& operator=(const OscBatcher&) = delete;
+
+    // Queue a copy of the message's current contents
+    unsigned add(const OscMessageTemplate& msg, OscTimetag tag, unsigned weight, uint64_t nowUs);
+
+    // Queue the batch if its window has expired
+    unsigned flushIfDue(uint64_t nowUs);
+
+    // Queue whatever is pending
+    unsigned flush();
+
+    bool pending() const { return !writer_.empty(); }
+
+    // Host time at which the pending batch must go out (only valid if pending())
+    uint64_t deadlineUs() const { return deadlineUs_; }
+
+    uint64_t bundlesSent() const { return bundlesSent_; }
+    uint64_t messagesSent() const { return messagesSent_; }
+    uint64_t sendErrors() const { return sendErrors_; }
+
+private:
+    UdpTransport& transport_;
+    uint32_t destinations_;
+    uint64_t windowUs_;
+    size_t maxBytes_;
+    OscBundleWriter writer_;
+
+    unsigned weight_ = 0;
+    uint64_t deadlineUs_ = 0;
+
+    uint64_t bundlesSent_ = 0;
+    uint64_t messagesSent_ = 0;
+    uint64_t sendErrors_ = 0;
+};
+
+#endif // OSC_BATCHER_H
@@ -0,0 +1,144 @@
+#include "osc_encoder.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// "#bundle\0" followed by the 64-bit timetag
+static const size_t BUNDLE_HEADER_SIZE = 16;
+// Every bundle element is preceded by its 32-bit size
+static const size_t ELEMENT_SIZE_PREFIX = 4;
+
+// OSC strings are NUL terminated and padded to a multiple of 4 bytes
+static size_t paddedStringSize(size_t length) {
+    return (length + 4) & ~(size_t)3;
+}
+
+OscMessageTemplate::OscMessageTemplate(const char* address, const char* typetags) {
+    memset(bytes_, 0, sizeof(bytes_));
+    memset(argOffset_, 0, sizeof(argOffset_));
+
+    size_t addressSize = paddedStringSize(strlen(address));
+    size_t typetagCount = strlen(typetags);
+    size_t typetagSize = paddedStringSize(typetagCount + 1); // leading ','
+
+    size_t pos = addressSize + typetagSize;
+    if (typetagCount > (size_t)MAX_ARGS || pos > MAX_SIZE) {
+        printf("OSC template %s: address or type tags too long\n", address);
+        return;
+    }
+    memcpy(bytes_, address, strlen(address));
+    bytes_[addressSize] = ',';
+    memcpy(bytes_ + addressSize + 1, typetags, typetagCount);
+
+    for (size_t i = 0; i < typetagCount; ++i) {
+        size_t width;
+        switch (typetags[i]) {
+            case 'i':
+            case 'f':
+                width = 4;
+                break;
+            case 'h':
+            case 'd':
+                width = 8;
+                break;
+            default:
+                printf("OSC template %s: unsupported type '%c'\n", address, typetags[i]);
+                return;
+        }
+        if (pos + width > MAX_SIZE) {
+            printf("OSC template %s: arguments too long\n", address);
+            return;
+        }
+        argOffset_[i] = (uint16_t)pos;
+        pos += width;
+    }
+    size_ = pos;
+}
+
+void OscMessageTemplate::setFloat(int arg, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put32(bytes_ + argOffset_[arg], bits);
+}
+
+void OscMessageTemplate::setDouble(int arg, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put64(bytes_ + argOffset_[arg], bits);
+}
+
+OscBundleWriter::OscBundleWriter(size_t capacity)
+    : buffer_(new uint8_t[capacity]), capacity_(capacity) {}
+
+OscBundleWriter::~OscBundleWriter() {
+    delete[] buffer_;
+}
+
+void OscBundleWriter::reset() {
+    pos_ = 0;
+    innerStart_ = 0;
+    inners_ = 0;
+    messages_ = 0;
+}
+
+size_t OscBundleWriter::bytesNeeded(const OscMessageTemplate& msg, OscTimetag tag) const {
+    size_t bytes = ELEMENT_SIZE_PREFIX + msg.size();
+    if (!sameTag(tag)) {
+        bytes += ELEMENT_SIZE_PREFIX + BUNDLE_HEADER_SIZE;
+    }
+    if (pos_ == 0) {
+        bytes += BUNDLE_HEADER_SIZE;
+    }
+    return bytes;
+}
+
+void OscBundleWriter::writeBundleHeader(OscTimetag tag) {
+    memcpy(buffer_ + pos_, "#bundle", 8);
+    OscMessageTemplate::put32(buffer_ + pos_ + 8, tag.sec);
+    OscMessageTemplate::put32(buffer_ + pos_ + 12, tag.frac);
+    pos_ += BUNDLE_HEADER_SIZE;
+}
+
+void OscBundleWriter::closeInner() {
+    if (innerStart_ != 0) {
+        OscMessageTemplate::put32(buffer_ + innerStart_, (uint32_t)(pos_ - innerStart_ - ELEMENT_SIZE_PREFIX));
+        innerStart_ = 0;
+    }
+}
+
+bool OscBundleWriter::add(const OscMessageTemplate& msg, OscTimetag tag) {
+    if (pos_ + bytesNeeded(msg, tag) > capacity_) {
+        return false;
+    }
+
+    if (pos_ == 0) {
+        writeBundleHeader(OSC_TT_IMMEDIATE);
+    }
+    if (!sameTag(tag)) {
+        closeInner();
+        innerStart_ = pos_;
+        innerTag_ = tag;
+        pos_ += ELEMENT_SIZE_PREFIX;
+        writeBundleHeader(tag);
+        inners_++;
+    }
+
+    OscMessageTemplate::put32(buffer_ + pos_, (uint32_t)msg.size());
+    memcpy(buffer_ + pos_ + ELEMENT_SIZE_PREFIX, msg.data(), msg.size());
+    pos_ += ELEMENT_SIZE_PREFIX + msg.size();
+    messages_++;
+    return true;
+}
+
+const uint8_t* OscBundleWriter::finish(size_t* length) {
+    size_t lastInner = innerStart_;
+    closeInner();
+
+    // A single nested bundle does not need the outer wrapper
+    if (inners_ == 1) {
+        *length = pos_ - lastInner - ELEMENT_SIZE_PREFIX;
+        return buffer_ + lastInner + ELEMENT_SIZE_PREFIX;
+    }
+    *length = pos_;
+    return buffer_;
+}
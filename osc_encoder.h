@@ -0,0 +1,103 @@
+#ifndef OSC_ENCODER_H
+#define OSC_ENCODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Allocation-free OSC 1.0 encoding for the fixed-shape messages on the hot path.
+
+struct OscTimetag {
+    uint32_t sec;
+    uint32_t frac;
+};
+
+static const OscTimetag OSC_TT_IMMEDIATE = {0, 1};
+
+// A message whose address and type tags never change. Both are serialized once
+// at construction; per sample only the big-endian arguments are patched in place.
+// Type tags use liblo notation without the leading comma ("fff"); supported
+// argument types are i, f (32 bit) and h, d (64 bit).
+class OscMessageTemplate {
+public:
+    static const size_t MAX_SIZE = 256;
+    static const int MAX_ARGS = 16;
+
+    OscMessageTemplate(const char* address, const char* typetags);
+
+    // An empty, invalid template; only useful to assign a copy of another to
+    OscMessageTemplate() = default;
+
+    // False if the address or type tags did not fit or contained unsupported types
+    bool valid() const { return size_ > 0; }
+
+    void setInt(int arg, int32_t value) { put32(bytes_ + argOffset_[arg], (uint32_t)value); }
+    void setFloat(int arg, float value);
+    void setInt64(int arg, int64_t value) { put64(bytes_ + argOffset_[arg], (uint64_t)value); }
+    void setDouble(int arg, double value);
+
+    const char* address() const { return (const char*)bytes_; }
+    const uint8_t* data() const { return bytes_; }
+    size_t size() const { return size_; }
+
+    static void put32(uint8_t* p, uint32_t v) {
+        p[0] = (uint8_t)(v >> 24);
+        p[1] = (uint8_t)(v >> 16);
+        p[2] = (uint8_t)(v >> 8);
+        p[3] = (uint8_t)v;
+    }
+
+    static void put64(uint8_t* p, uint64_t v) {
+        put32(p, (uint32_t)(v >> 32));
+        put32(p + 4, (uint32_t)v);
+    }
+
+private:
+    uint8_t bytes_[MAX_SIZE];
+    uint16_t argOffset_[MAX_ARGS];
+    size_t size_ = 0;
+};
+
+// Builds a bundle datagram into a buffer allocated once up front.
+//
+// Consecutive messages with the same timetag share a nested bundle; the outer
+// bundle is tagged "immediately". When the whole datagram holds a single
+// nested bundle, finish() returns just that bundle.
+class OscBundleWriter {
+public:
+    explicit OscBundleWriter(size_t capacity);
+    ~OscBundleWriter();
+
+    OscBundleWriter(const OscBundleWriter&) = delete;
+    OscBundleWriter& operator=(const OscBundleWriter&) = delete;
+
+    void reset();
+    bool empty() const { return messages_ == 0; }
+    unsigned messages() const { return messages_; }
+
+    // Current datagram size
+    size_t size() const { return pos_; }
+
+    // How much add() would grow the datagram by
+    size_t bytesNeeded(const OscMessageTemplate& msg, OscTimetag tag) const;
+
+    // Append a message; false if it does not fit in the buffer
+    bool add(const OscMessageTemplate& msg, OscTimetag tag);
+
+    // Close the open nested bundle and return the datagram
+    const uint8_t* finish(size_t* length);
+
+private:
+    bool sameTag(OscTimetag tag) const { return innerStart_ != 0 && tag.sec == innerTag_.sec && tag.frac == innerTag_.frac; }
+    void closeInner();
+    void writeBundleHeader(OscTimetag tag);
+
+    uint8_t* buffer_;
+    size_t capacity_;
+    size_t pos_ = 0;
+    size_t innerStart_ = 0; // offset of the open nested bundle's size prefix, 0 if none
+    OscTimetag innerTag_ = {0, 0};
+    unsigned inners_ = 0;
+    unsigned messages_ = 0;
+};
+
+#endif // OSC_ENCODER_H
@@ -0,0 +1,247 @@
+#include "osc_fanout.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool parseOscDestination(const char* spec, OscDestinationConfig* config) {
+    memset(config, 0, sizeof(*config));
+
+    const char* portStart = strchr(spec, ':');
+    if (!portStart || portStart == spec || (size_t)(portStart - spec) >= sizeof(config->host)) {
+        return false;
+    }
+    memcpy(config->host, spec, portStart - spec);
+    portStart++;
+
+    const char* rateStart = strchr(portStart, ':');
+    size_t portLength = rateStart ? (size_t)(rateStart - portStart) : strlen(portStart);
+    if (portLength == 0 || portLength >= sizeof(config->port)) {
+        return false;
+    }
+    memcpy(config->port, portStart, portLength);
+
+    if (rateStart) {
+        char* end;
+        config->maxRate = strtod(rateStart + 1, &end);
+        if (config->maxRate < 0) {
+            return false;
+        }
+        if (*end == ':') {
+            snprintf(config->filter, sizeof(config->filter), "%s", end + 1);
+        } else if (*end != '\0') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// True if address starts with one of the comma-separated prefixes
+static bool matchesFilter(const char* filter, const char* address) {
+    if (filter[0] == '\0') {
+        return true;
+    }
+    const char* prefix = filter;
+    while (*prefix) {
+        const char* end = strchr(prefix, ',');
+        size_t length = end ? (size_t)(end - prefix) : strlen(prefix);
+        if (length > 0 && strncmp(address, prefix, length) == 0) {
+            return true;
+        }
+        if (!end) {
+            break;
+        }
+        prefix = end + 1;
+    }
+    return false;
+}
+
+OscFanout::OscFanout(UdpTransport& transport, uint64_t windowUs, size_t maxBytes)
+    : transport_(transport), windowUs_(windowUs), maxBytes_(maxBytes) {}
+
+bool OscFanout::addDestination(const OscDestinationConfig& config) {
+    int index = transport_.addDestination(config.host, config.port);
+    if (index < 0) {
+        return false;
+    }
+
+    uint64_t minIntervalUs = config.maxRate > 0 ? (uint64_t)(1000000.0 / config.maxRate) : 0;
+    for (int i = 0; i < routeCount_; ++i) {
+        Route& route = routes_[i];
+        if (route.minIntervalUs == minIntervalUs && strcmp(route.filter, config.filter) == 0) {
+            route.destinations |= 1u << index;
+            route.batcher.reset(new OscBatcher(transport_, route.destinations, windowUs_, maxBytes_));
+            return true;
+        }
+    }
+
+    Route& route = routes_[routeCount_++];
+    route.destinations = 1u << index;
+    route.primary = index == 0;
+    route.minIntervalUs = minIntervalUs;
+    snprintf(route.filter, sizeof(route.filter), "%s", config.filter);
+    route.templateCount = 0;
+    route.streams.reset(minIntervalUs > 0 ? new StreamState[MAX_STREAMS]() : nullptr);
+    route.heldCount = 0;
+    route.nextReleaseUs = UINT64_MAX;
+    route.streamsFull = false;
+    route.filtered = 0;
+    route.rateLimited = 0;
+    route.batcher.reset(new OscBatcher(transport_, route.destinations, windowUs_, maxBytes_));
+    return true;
+}
+
+bool OscFanout::accepts(Route& route, const OscMessageTemplate& msg) {
+    for (int i = 0; i < route.templateCount; ++i) {
+        if (route.templates[i].msg == &msg) {
+            return route.templates[i].accepted;
+        }
+    }
+    bool accepted = matchesFilter(route.filter, msg.address());
+    if (route.templateCount < MAX_TEMPLATES) {
+        route.templates[route.templateCount++] = {&msg, accepted};
+    }
+    return accepted;
+}
+
+// The stream's slot in the route's open-addressing table; NULL when the table is full
+OscFanout::StreamState* OscFanout::findStream(Route& route, const OscMessageTemplate& msg, int32_t key) {
+    uint32_t hash = (uint32_t)((uintptr_t)&msg >> 4) * 2654435761u ^ (uint32_t)key * 40503u;
+    for (int probe = 0; probe < MAX_STREAMS; ++probe) {
+        StreamState& state = route.streams[(hash + probe) % MAX_STREAMS];
+        if (state.msg == &msg && state.key == key) {
+            return &state;
+        }
+        if (!state.msg) {
+            state.msg = &msg;
+            state.key = key;
+            state.lastSentUs = 0;
+            state.held = false;
+            return &state;
+        }
+    }
+    if (!route.streamsFull) {
+        route.streamsFull = true;
+        printf("OSC route (filter '%s'): more than %d streams, the rest are not rate limited\n",
+               route.filter[0] ? route.filter : "*", MAX_STREAMS);
+    }
+    return NULL;
+}
+
+// Send the held stream values whose slot has come (all of them for a final flush)
+unsigned OscFanout::releaseHeld(Route& route, uint64_t nowUs, bool all) {
+    if (route.heldCount == 0 || (!all && nowUs < route.nextReleaseUs)) {
+        return 0;
+    }
+    unsigned delivered = 0;
+    route.nextReleaseUs = UINT64_MAX;
+    for (int i = 0; i < MAX_STREAMS && route.heldCount > 0; ++i) {
+        StreamState& state = route.streams[i];
+        if (!state.held) {
+            continue;
+        }
+        uint64_t slotUs = state.lastSentUs + route.minIntervalUs;
+        if (all || slotUs <= nowUs) {
+            state.held = false;
+            state.lastSentUs = nowUs;
+            route.heldCount--;
+            delivered += route.batcher->add(state.heldMessage, state.heldTag, state.heldWeight, nowUs);
+        } else if (slotUs < route.nextReleaseUs) {
+            route.nextReleaseUs = slotUs;
+        }
+    }
+    return delivered;
+}
+
+unsigned OscFanout::add(const OscMessageTemplate& msg, OscTimetag tag, unsigned weight, uint64_t nowUs,
+                        int32_t stream) {
+    unsigned delivered = 0;
+    for (int i = 0; i < routeCount_; ++i) {
+        Route& route = routes_[i];
+        if (!accepts(route, msg)) {
+            route.filtered++;
+            continue;
+        }
+        StreamState* state = route.minIntervalUs > 0 && stream != EVENT ? findStream(route, msg, stream) : NULL;
+        if (state) {
+            if (state->held) {
+                route.rateLimited++; // replaced, now or below, by this newer value
+            }
+            if (state->lastSentUs != 0 && nowUs - state->lastSentUs < route.minIntervalUs) {
+                if (!state->held) {
+                    state->held = true;
+                    route.heldCount++;
+                }
+                state->heldMessage = msg;
+                state->heldTag = tag;
+                state->heldWeight = weight;
+                uint64_t slotUs = state->lastSentUs + route.minIntervalUs;
+                route.nextReleaseUs = slotUs < route.nextReleaseUs ? slotUs : route.nextReleaseUs;
+                continue;
+            }
+            if (state->held) {
+                state->held = false;
+                route.heldCount--;
+            }
+            state->lastSentUs = nowUs;
+        }
+        unsigned n = route.batcher->add(msg, tag, weight, nowUs);
+        delivered += route.primary ? n : 0;
+    }
+    return delivered;
+}
+
+unsigned OscFanout::flushIfDue(uint64_t nowUs) {
+    unsigned delivered = 0;
+    for (int i = 0; i < routeCount_; ++i) {
+        unsigned n = releaseHeld(routes_[i], nowUs, false);
+        n += routes_[i].batcher->flushIfDue(nowUs);
+        delivered += routes_[i].primary ? n : 0;
+    }
+    return delivered;
+}
+
+unsigned OscFanout::flush() {
+    unsigned delivered = 0;
+    for (int i = 0; i < routeCount_; ++i) {
+        unsigned n = releaseHeld(routes_[i], 0, true);
+        n += routes_[i].batcher->flush();
+        delivered += routes_[i].primary ? n : 0;
+    }
+    return delivered;
+}
+
+bool OscFanout::pending() const {
+    for (int i = 0; i < routeCount_; ++i) {
+        if (routes_[i].batcher->pending() || routes_[i].heldCount > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t OscFanout::deadlineUs() const {
+    uint64_t deadline = UINT64_MAX;
+    for (int i = 0; i < routeCount_; ++i) {
+        if (routes_[i].batcher->pending() && routes_[i].batcher->deadlineUs() < deadline) {
+            deadline = routes_[i].batcher->deadlineUs();
+        }
+        if (routes_[i].heldCount > 0 && routes_[i].nextReleaseUs < deadline) {
+            deadline = routes_[i].nextReleaseUs;
+        }
+    }
+    return deadline;
+}
+
+void OscFanout::printStats() const {
+    for (int i = 0; i < routeCount_; ++i) {
+        const Route& route = routes_[i];
+        printf("OSC route %d (filter '%s', %s): %llu messages in %llu bundles, %llu filtered, %llu replaced by newer\n",
+               i, route.filter[0] ? route.filter : "*",
+               route.minIntervalUs ? "rate limited" : "unlimited",
+               (unsigned long long)route.batcher->messagesSent(),
+               (unsigned long long)route.batcher->bundlesSent(),
+               (unsigned long long)route.filtered,
+               (unsigned long long)route.rateLimited);
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef OSC_FANOUT_H
+#define OSC_FANOUT_H
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include "osc_batcher.h"
+#include "osc_encoder.h"
+#include "udp_transport.h"
+
+// One OSC consumer, parsed from HOST:PORT[:RATE[:FILTER]]
+struct OscDestinationConfig {
+    char host[64];
+    char port[8];
+    double maxRate;  // messages per second per continuous stream, 0 = unlimited
+    char filter[128]; // comma-separated address prefixes, empty = everything
+};
+
+bool parseOscDestination(const char* spec, OscDestinationConfig* config);
+
+// Distributes every encoded message to a list of destinations.
+//
+// Destinations with the same rate limit and filter share one route: the
+// message is batched once, the bundle is copied once into the transport and
+// sent to all of them from the same bytes. Messages are never re-encoded per
+// destination; a route only copies the bytes the template already holds.
+// The filter decision per message template is cached, so a route costs a
+// table lookup per message.
+//
+// A route's rate limit only applies to continuous streams, such as one
+// controller's /ps5/imu or one of its axes; the caller names the stream with
+// a key per template. Discrete events (buttons, touches, gestures) pass
+// EVENT and are never limited. A stream value that arrives before its next
+// slot is held rather than dropped: a newer value replaces it, and the held
+// one goes out at the slot from flushIfDue(), so the destination always ends
+// up with the latest state.
+class OscFanout {
+public:
+    static const int MAX_ROUTES = UdpTransport::MAX_DESTINATIONS;
+    static const int32_t EVENT = -1;
+    static const int MAX_STREAMS = 128; // rate-limited streams per route
+
+    OscFanout(UdpTransport& transport, uint64_t windowUs, size_t maxBytes);
+
+    bool addDestination(const OscDestinationConfig& config);
+
+    // Returns the readings the primary (first) destination's route handed to the transport
+    unsigned add(const OscMessageTemplate& msg, OscTimetag tag, unsigned weight, uint64_t nowUs,
+                 int32_t stream = EVENT);
+    unsigned flushIfDue(uint64_t nowUs);
+    unsigned flush();
+
+    bool pending() const;
+    uint64_t deadlineUs() const; // earliest deadline of the pending routes and held stream values
+
+    void printStats() const;
+
+private:
+    static const int MAX_TEMPLATES = 16;
+
+    struct TemplateState {
+        const OscMessageTemplate* msg;
+        bool accepted;
+    };
+
+    struct StreamState {
+        const OscMessageTemplate* msg; // NULL for a free slot
+        int32_t key;
+        uint64_t lastSentUs;
+        bool held;
+        OscTimetag heldTag;
+        unsigned heldWeight;
+        OscMessageTemplate heldMessage;
+    };
+
+    struct Route {
+        std::unique_ptr<OscBatcher> batcher;
+        uint32_t destinations;
+        bool primary;
+        uint64_t minIntervalUs;
+        char filter[128];
+        TemplateState templates[MAX_TEMPLATES];
+        int templateCount;
+        std::unique_ptr<StreamState[]> streams; // hash table of MAX_STREAMS, only with a rate limit
+        int heldCount;
+        uint64_t nextReleaseUs; // no held value is due before this
+        bool streamsFull;
+        uint64_t filtered;
+        uint64_t rateLimited; // stream values replaced by a newer one before they went out
+    };
+
+    bool accepts(Route& route, const OscMessageTemplate& msg);
+    StreamState* findStream(Route& route, const OscMessageTemplate& msg, int32_t key);
+    unsigned releaseHeld(Route& route, uint64_t nowUs, bool all);
+
+    UdpTransport& transport_;
+    uint64_t windowUs_;
+    size_t maxBytes_;
+    Route routes_[MAX_ROUTES];
+    int routeCount_ = 0;
+};
+
+#endif // OSC_FANOUT_H
@@ -0,0 +1,116 @@
+#include "output_control.h"
+
+#include <stdio.h>
+
+static uint8_t clampByte(int32_t value) {
+    return (uint8_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+static void reportError(int number, const char* message, const char* path) {
+    printf("OSC control server error %d in %s: %s\n", number, path ? path : "-", message);
+}
+
+OutputControl::~OutputControl() {
+    if (server_) {
+        lo_server_thread_stop(server_);
+        lo_server_thread_free(server_);
+    }
+}
+
+bool OutputControl::listen(const char* port) {
+    server_ = lo_server_thread_new(port, reportError);
+    if (!server_) {
+        printf("Could not listen for output commands on port %s\n", port);
+        return false;
+    }
+    // Typed methods let liblo convert floats from Max to the integers expected here
+    lo_server_thread_add_method(server_, "/ps5/rumble", "iii", handleRumble, this);
+    lo_server_thread_add_method(server_, "/ps5/lightbar", "iiii", handleLightbar, this);
+    lo_server_thread_add_method(server_, "/ps5/player_leds", "ii", handlePlayerLeds, this);
+    lo_server_thread_add_method(server_, "/ps5/mute_led", "ii", handleMuteLed, this);
+    lo_server_thread_add_method(server_, "/ps5/trigger", NULL, handleTrigger, this);
+    if (lo_server_thread_start(server_) < 0) {
+        printf("Could not start the OSC control server\n");
+        lo_server_thread_free(server_);
+        server_ = nullptr;
+        return false;
+    }
+    printf("Output commands: OSC on port %d\n", lo_server_thread_get_port(server_));
+    return true;
+}
+
+void OutputControl::setMaxRate(double hz) {
+    for (DsOutputScheduler& scheduler : schedulers_) {
+        scheduler.setMaxRate(hz);
+    }
+}
+
+void OutputControl::printStats() const {
+    for (int i = 0; i < MAX_CONTROLLERS; ++i) {
+        char label[32];
+        snprintf(label, sizeof(label), "Controller %d", i);
+        schedulers_[i].printStats(label);
+    }
+}
+
+int OutputControl::handleRumble(const char*, const char*, lo_arg** argv, int, lo_message, void* user) {
+    DsOutputScheduler* scheduler = static_cast<OutputControl*>(user)->forController(argv[0]->i);
+    if (scheduler) {
+        scheduler->setRumble(clampByte(argv[1]->i), clampByte(argv[2]->i));
+    }
+    return 0;
+}
+
+int OutputControl::handleLightbar(const char*, const char*, lo_arg** argv, int, lo_message, void* user) {
+    DsOutputScheduler* scheduler = static_cast<OutputControl*>(user)->forController(argv[0]->i);
+    if (scheduler) {
+        scheduler->setLightbar(clampByte(argv[1]->i), clampByte(argv[2]->i), clampByte(argv[3]->i));
+    }
+    return 0;
+}
+
+int OutputControl::handlePlayerLeds(const char*, const char*, lo_arg** argv, int, lo_message, void* user) {
+    DsOutputScheduler* scheduler = static_cast<OutputControl*>(user)->forController(argv[0]->i);
+    if (scheduler) {
+        scheduler->setPlayerLeds(clampByte(argv[1]->i));
+    }
+    return 0;
+}
+
+int OutputControl::handleMuteLed(const char*, const char*, lo_arg** argv, int, lo_message, void* user) {
+    DsOutputScheduler* scheduler = static_cast<OutputControl*>(user)->forController(argv[0]->i);
+    if (scheduler) {
+        scheduler->setMuteLed(clampByte(argv[1]->i));
+    }
+    return 0;
+}
+
+// Variable length, so the numbers are converted here
+int OutputControl::handleTrigger(const char* path, const char* types, lo_arg** argv, int argc, lo_message,
+                                 void* user) {
+    if (argc < 3 || argc > 3 + DS_TRIGGER_EFFECT_SIZE - 1) {
+        printf("%s: expected controller side mode and up to %d parameters\n", path, DS_TRIGGER_EFFECT_SIZE - 1);
+        return 0;
+    }
+    int32_t values[3 + DS_TRIGGER_EFFECT_SIZE - 1];
+    for (int i = 0; i < argc; ++i) {
+        if (types[i] == LO_INT32) {
+            values[i] = argv[i]->i;
+        } else if (types[i] == LO_FLOAT) {
+            values[i] = (int32_t)argv[i]->f;
+        } else {
+            printf("%s: arguments must be numbers\n", path);
+            return 0;
+        }
+    }
+
+    DsOutputScheduler* scheduler = static_cast<OutputControl*>(user)->forController(values[0]);
+    if (scheduler) {
+        uint8_t effect[DS_TRIGGER_EFFECT_SIZE];
+        for (int i = 2; i < argc; ++i) {
+            effect[i - 2] = clampByte(values[i]);
+        }
+        scheduler->setTriggerEffect(values[1], effect, argc - 2);
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef OUTPUT_CONTROL_H
+#define OUTPUT_CONTROL_H
+
+#include <stdint.h>
+#include <lo/lo.h>
+#include "dualsense_output.h"
+
+// Receives rumble, light and trigger commands over OSC and keeps one
+// DsOutputScheduler per controller; the input backends write what the
+// schedulers hand out to their devices. Every message starts with the
+// controller number that the input messages carry:
+//
+//   /ps5/rumble controller low high          motors 0..255 (heavy, light)
+//   /ps5/lightbar controller red green blue  0..255
+//   /ps5/player_leds controller mask         bits 0..4, leftmost LED first
+//   /ps5/mute_led controller mode            0 off, 1 on, 2 pulse
+//   /ps5/trigger controller side mode p...   side 0 left, 1 right; effect mode and up to 10 parameters
+//
+// liblo handles the messages on its own thread.
+class OutputControl {
+public:
+    static const int MAX_CONTROLLERS = 8;
+
+    OutputControl() = default;
+    ~OutputControl();
+
+    OutputControl(const OutputControl&) = delete;
+    OutputControl& operator=(const OutputControl&) = delete;
+
+    // Start listening for commands on a UDP port
+    bool listen(const char* port);
+
+    void setMaxRate(double hz);
+
+    // Scheduler of a controller, nullptr if out of range
+    DsOutputScheduler* forController(int32_t controller) {
+        return controller >= 0 && controller < MAX_CONTROLLERS ? &schedulers_[controller] : nullptr;
+    }
+
+    void printStats() const;
+
+private:
+    static int handleRumble(const char* path, const char* types, lo_arg** argv, int argc, lo_message msg, void* user);
+    static int handleLightbar(const char* path, const char* types, lo_arg** argv, int argc, lo_message msg, void* user);
+    static int handlePlayerLeds(const char* path, const char* types, lo_arg** argv, int argc, lo_message msg,
+                                void* user);
+    static int handleMuteLed(const char* path, const char* types, lo_arg** argv, int argc, lo_message msg, void* user);
+    static int handleTrigger(const char* path, const char* types, lo_arg** argv, int argc, lo_message msg, void* user);
+
+    lo_server_thread server_ = nullptr;
+    DsOutputScheduler schedulers_[MAX_CONTROLLERS];
+};
+
+#endif // OUTPUT_CONTROL_H
@@ -0,0 +1,136 @@
+/*
+ * Shared-memory layout of the ps5_kontroller live sample stream.
+ *
+ * Started with --shm NAME, ps5_kontroller creates the POSIX shared memory
+ * object NAME holding a ps5_shm_header followed by `capacity` records. Every
+ * input sample is written to slot (index & (capacity - 1)) and published by
+ * bumping write_index. Each record is guarded by its own sequence counter
+ * (odd while the writer is inside it), so readers never block the writer and
+ * simply retry a torn read.
+ *
+ * Readers map the object read-only:
+ *
+ *     size_t size;
+ *     const ps5_shm_header* shm = ps5_shm_open_reader("/ps5_kontroller", &size);
+ *     uint64_t next = ps5_shm_write_index(shm);
+ *     for (;;) {
+ *         ps5_shm_record rec;
+ *         int rc = ps5_shm_read(shm, next, &rec);
+ *         if (rc == PS5_SHM_OK) { use(&rec); next++; }
+ *         else if (rc == PS5_SHM_OVERRUN) next = ps5_shm_write_index(shm);
+ *         else wait_a_bit();
+ *     }
+ *
+ * Plain C99 plus the GCC/Clang __atomic builtins; no library to link.
+ */
+#ifndef PS5_SHM_H
+#define PS5_SHM_H
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PS5_SHM_MAGIC 0x53355350u /* "PS5S" */
+#define PS5_SHM_VERSION 1
+
+/* Record kinds, identical to SampleKind in sample.h */
+enum {
+    PS5_SHM_GYRO = 0,
+    PS5_SHM_ACCEL = 1,
+    PS5_SHM_IMU = 2,    /* data[0..2] gyro, data[3..5] accel */
+    PS5_SHM_BUTTON = 3, /* code = button, value = pressed */
+    PS5_SHM_AXIS = 4,   /* code = axis, value = position */
+    PS5_SHM_TOUCH = 5   /* code = finger, value = down, data[0..1] = x, y in 0..1, data[2] = contact id */
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;     /* number of records, a power of two */
+    uint32_t record_size;  /* sizeof(ps5_shm_record) */
+    uint64_t write_index;  /* records published so far */
+    uint64_t start_host_us; /* writer's monotonic clock at creation */
+    uint8_t reserved[32];
+} ps5_shm_header;
+
+typedef struct {
+    uint32_t seq;          /* odd while being written */
+    uint8_t kind;
+    uint8_t reserved[3];
+    uint64_t index;        /* write index this slot currently holds */
+    int32_t controller;
+    int32_t code;
+    int32_t value;
+    float data[6];
+    uint64_t timestamp_us; /* controller sensor timestamp, 0 if not provided */
+    uint64_t host_time_us; /* sample time on the writer's monotonic clock */
+} ps5_shm_record;
+
+enum {
+    PS5_SHM_OK = 0,
+    PS5_SHM_NOT_YET = -1, /* index has not been published */
+    PS5_SHM_OVERRUN = -2  /* the writer has already reused the slot */
+};
+
+static inline ps5_shm_record* ps5_shm_records(const ps5_shm_header* shm) {
+    return (ps5_shm_record*)((uint8_t*)shm + sizeof(ps5_shm_header));
+}
+
+static inline size_t ps5_shm_size(uint32_t capacity) {
+    return sizeof(ps5_shm_header) + (size_t)capacity * sizeof(ps5_shm_record);
+}
+
+static inline uint64_t ps5_shm_write_index(const ps5_shm_header* shm) {
+    return __atomic_load_n(&shm->write_index, __ATOMIC_ACQUIRE);
+}
+
+/* Copy record `index` into *out without tearing */
+static inline int ps5_shm_read(const ps5_shm_header* shm, uint64_t index, ps5_shm_record* out) {
+    const ps5_shm_record* slot = &ps5_shm_records(shm)[index & (shm->capacity - 1)];
+    for (;;) {
+        if (index >= ps5_shm_write_index(shm)) {
+            return PS5_SHM_NOT_YET;
+        }
+        uint32_t before = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            continue;
+        }
+        *out = *slot;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != before) {
+            continue;
+        }
+        return out->index == index ? PS5_SHM_OK : PS5_SHM_OVERRUN;
+    }
+}
+
+/* Map an existing stream read-only; NULL if it does not exist or is incompatible */
+static inline const ps5_shm_header* ps5_shm_open_reader(const char* name, size_t* size) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(ps5_shm_header)) {
+        close(fd);
+        return NULL;
+    }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        return NULL;
+    }
+    const ps5_shm_header* shm = (const ps5_shm_header*)p;
+    if (shm->magic != PS5_SHM_MAGIC || shm->version != PS5_SHM_VERSION ||
+        shm->record_size != sizeof(ps5_shm_record) || (size_t)st.st_size < ps5_shm_size(shm->capacity)) {
+        munmap(p, (size_t)st.st_size);
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    return shm;
+}
+
+#endif /* PS5_SHM_H */
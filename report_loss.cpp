@@ -0,0 +1,77 @@
+#include "report_loss.h"
+
+#include <math.h>
+
+void ReportLossTracker::reset() {
+    started_ = false;
+    period_ = 0.0;
+}
+
+ReportLossStats ReportLossTracker::takeInterval() {
+    ReportLossStats interval;
+    interval.received = totals_.received - reported_.received;
+    interval.dropped = totals_.dropped - reported_.dropped;
+    interval.duplicated = totals_.duplicated - reported_.duplicated;
+    interval.outOfOrder = totals_.outOfOrder - reported_.outOfOrder;
+    reported_ = totals_;
+    return interval;
+}
+
+// Follow the report period through consecutive reports; a much shorter step
+// means the first guess spanned a gap
+void ReportLossTracker::learnPeriod(uint32_t step) {
+    if (period_ == 0.0 || step < 0.75 * period_) {
+        period_ = step;
+    } else {
+        period_ += (step - period_) / 32.0;
+    }
+}
+
+bool ReportLossTracker::track(bool hasSequence, uint8_t sequence, uint32_t time) {
+    totals_.received++;
+    if (!started_) {
+        started_ = true;
+        lastSequence_ = sequence;
+        lastTime_ = time;
+        return true;
+    }
+
+    int32_t step = (int32_t)(time - lastTime_);
+    uint8_t sequenceStep = (uint8_t)(sequence - lastSequence_);
+    if (step == 0 && (!hasSequence || sequenceStep == 0)) {
+        totals_.duplicated++;
+        return false;
+    }
+    if (step < 0) {
+        // Counted as dropped when the newer report came in
+        totals_.outOfOrder++;
+        totals_.dropped -= totals_.dropped > 0 ? 1 : 0;
+        return false;
+    }
+
+    uint64_t missing = 0;
+    if (hasSequence) {
+        // The counter alone cannot see whole wraps; the elapsed time can
+        missing = (uint8_t)(sequenceStep - 1);
+        if (period_ > 0.0) {
+            double wraps = floor((step / period_ - 1.0 - missing) / 256.0 + 0.5);
+            missing += wraps > 0 ? (uint64_t)wraps * 256 : 0;
+        }
+        if (sequenceStep == 1 && (period_ == 0.0 || step < 2.0 * period_)) {
+            learnPeriod((uint32_t)step);
+        }
+    } else {
+        if (period_ > 0.0) {
+            double periods = floor(step / period_ + 0.5);
+            missing = periods > 1.0 ? (uint64_t)periods - 1 : 0;
+        }
+        if (missing == 0) {
+            learnPeriod((uint32_t)step);
+        }
+    }
+
+    totals_.dropped += missing;
+    lastSequence_ = sequence;
+    lastTime_ = time;
+    return true;
+}
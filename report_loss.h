@@ -0,0 +1,52 @@
+#ifndef REPORT_LOSS_H
+#define REPORT_LOSS_H
+
+#include <stdint.h>
+
+struct ReportLossStats {
+    uint64_t received = 0;
+    uint64_t dropped = 0;    // reports that never arrived
+    uint64_t duplicated = 0; // same report delivered again
+    uint64_t outOfOrder = 0; // arrived after a newer report; not decoded again
+
+    // Dropped reports as a share of the reports the controller sent
+    double lossPercent() const {
+        uint64_t sent = received - duplicated + dropped;
+        return sent > 0 ? 100.0 * dropped / sent : 0.0;
+    }
+};
+
+// Finds dropped, duplicated and reordered input reports of one controller.
+//
+// The DualSense numbers its reports with an 8-bit counter and stamps them with
+// its 32-bit sensor clock. The counter says how many reports are missing
+// between two arrivals; the time step, divided by the report period learned
+// from consecutive reports, says how many times the counter wrapped in a
+// longer outage. Sources without a counter (SDL) are tracked on time alone.
+class ReportLossTracker {
+public:
+    // Returns false for a duplicate or a report older than the newest one seen
+    bool add(uint8_t sequence, uint32_t time) { return track(true, sequence, time); }
+    bool addTimeOnly(uint32_t time) { return track(false, 0, time); }
+
+    void reset();
+
+    const ReportLossStats& totals() const { return totals_; }
+
+    // Counts since the previous call
+    ReportLossStats takeInterval();
+
+private:
+    bool track(bool hasSequence, uint8_t sequence, uint32_t time);
+    void learnPeriod(uint32_t step);
+
+    bool started_ = false;
+    uint8_t lastSequence_ = 0;
+    uint32_t lastTime_ = 0;
+    double period_ = 0.0; // time units per report, 0 until learned
+
+    ReportLossStats totals_;
+    ReportLossStats reported_;
+};
+
+#endif // REPORT_LOSS_H
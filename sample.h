@@ -0,0 +1,28 @@
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <stdint.h>
+
+// Kind of record passed from the acquisition thread to the transmit thread
+enum SampleKind : uint8_t {
+    SAMPLE_GYRO,
+    SAMPLE_ACCEL,
+    SAMPLE_IMU,    // gyro and accel from the same controller report
+    SAMPLE_BUTTON,
+    SAMPLE_AXIS,
+    SAMPLE_TOUCH   // touchpad finger: code = finger, value = down, data = x, y (0..1), contact id
+};
+
+// Fixed-size input record. Sensors fill data[], buttons and axes use code/value.
+struct Sample {
+    SampleKind kind;
+    uint8_t reserved[3];
+    int32_t controller;   // SDL joystick instance id
+    int32_t code;         // button or axis index
+    int32_t value;        // button state or axis position
+    float data[6];        // sensor x, y, z; SAMPLE_IMU holds gyro x, y, z then accel x, y, z
+    uint64_t timestampUs; // controller sensor timestamp, 0 if not provided
+    uint64_t hostTimeUs;  // timestampUs mapped to hostMonotonicUs(), or arrival time
+};
+
+#endif // SAMPLE_H
@@ -0,0 +1,324 @@
+#include "sdl_backend.h"
+
+#include <stdio.h>
+
+// SDL applies its own calibration, so its residual bias is kept apart from the HID backends'
+static const char GYRO_BIAS_KIND[] = "sdl_gyro_bias";
+
+static Sample makeSensorSample(SampleKind kind, SDL_JoystickID controller, const float* data,
+                               Uint64 sensorTimestampUs, DeviceClockSync& clock) {
+    Sample sample = {};
+    sample.kind = kind;
+    sample.controller = controller;
+    sample.data[0] = data[0];
+    sample.data[1] = data[1];
+    sample.data[2] = data[2];
+    sample.timestampUs = sensorTimestampUs;
+    sample.hostTimeUs = clock.map(sensorTimestampUs, hostMonotonicUs());
+    return sample;
+}
+
+static Sample makeInputSample(SampleKind kind, SDL_JoystickID controller, int code, int value) {
+    Sample sample = {};
+    sample.kind = kind;
+    sample.controller = controller;
+    sample.code = code;
+    sample.value = value;
+    sample.hostTimeUs = hostMonotonicUs();
+    return sample;
+}
+
+SdlBackend::SdlBackend(SampleSink& sink, AcquisitionMode mode, lo_address statusTarget)
+    : sink_(sink), mode_(mode), statusTarget_(statusTarget) {}
+
+SdlBackend::~SdlBackend() {
+    close();
+}
+
+bool SdlBackend::open() {
+    // Set the hint for PS5 rumble support
+    SDL_SetHint(SDL_HINT_JOYSTICK_HIDAPI_PS5_RUMBLE, "1");
+
+    // Initialize SDL
+    if (SDL_Init(SDL_INIT_GAMECONTROLLER | SDL_INIT_SENSOR) < 0) {
+        printf("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
+        return false;
+    }
+
+    // Open the first available controller
+    for (int i = 0; i < SDL_NumJoysticks(); ++i) {
+        if (SDL_IsGameController(i)) {
+            controller_ = SDL_GameControllerOpen(i);
+            if (controller_) {
+                printf("Controller opened: %s\n", SDL_GameControllerName(controller_));
+                break;
+            } else {
+                printf("Could not open controller: %s\n", SDL_GetError());
+            }
+        }
+    }
+
+    if (controller_ == NULL) {
+        printf("No controller detected!\n");
+        SDL_Quit();
+        return false;
+    }
+    controllerId_ = SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(controller_));
+    const char* serial = SDL_GameControllerGetSerial(controller_);
+    snprintf(serial_, sizeof(serial_), "%s", serial ? serial : "");
+    float bias[3];
+    if (loadGyroBias(GYRO_BIAS_KIND, serial_, bias)) {
+        gyroBias_.setBias(bias);
+        printf("Gyro bias cached: %.4f %.4f %.4f rad/s\n", bias[0], bias[1], bias[2]);
+    } else {
+        gyroBias_.setBias(nullptr);
+    }
+
+    // Enable sensors (Accelerometer and Gyroscope)
+    if (SDL_GameControllerHasSensor(controller_, SDL_SENSOR_ACCEL)) {
+        if (SDL_GameControllerSetSensorEnabled(controller_, SDL_SENSOR_ACCEL, SDL_TRUE) < 0) {
+            printf("Failed to enable accelerometer: %s\n", SDL_GetError());
+        } else {
+            accelEnabled_ = true;
+            printf("Accelerometer enabled.\n");
+        }
+    } else {
+        printf("Accelerometer is NOT supported.\n");
+    }
+
+    if (SDL_GameControllerHasSensor(controller_, SDL_SENSOR_GYRO)) {
+        if (SDL_GameControllerSetSensorEnabled(controller_, SDL_SENSOR_GYRO, SDL_TRUE) < 0) {
+            printf("Failed to enable gyroscope: %s\n", SDL_GetError());
+        } else {
+            gyroEnabled_ = true;
+            printf("Gyroscope enabled.\n");
+        }
+    } else {
+        printf("Gyroscope is NOT supported.\n");
+    }
+
+    pairImu_ = accelEnabled_ && gyroEnabled_;
+    wasConnected_ = true;
+    if (DsOutputScheduler* output = sink_.output ? sink_.output->forController(controllerId_) : nullptr) {
+        output->reset();
+    }
+    clock_.reset();
+    loss_.reset();
+    printf("Acquisition mode: %s\n", mode_ == ACQUIRE_EVENTS ? "events" : "poll");
+    return true;
+}
+
+void SdlBackend::close() {
+    if (controller_) {
+        // The next start begins with what was learned this time
+        if (gyroBias_.learned()) {
+            saveGyroBias(GYRO_BIAS_KIND, serial_, gyroBias_.bias());
+        }
+        SDL_GameControllerClose(controller_);
+        controller_ = NULL;
+        SDL_Quit();
+    }
+}
+
+bool SdlBackend::pump(int timeoutMs) {
+    SDL_Event event;
+    bool running = true;
+
+    // In event mode block until the next event, but wake up in time for the caller
+    bool haveEvent;
+    if (mode_ == ACQUIRE_EVENTS) {
+        haveEvent = SDL_WaitEventTimeout(&event, timeoutMs) != 0;
+    } else {
+        haveEvent = SDL_PollEvent(&event) != 0;
+    }
+
+    // Drain every queued event
+    for (; haveEvent; haveEvent = SDL_PollEvent(&event) != 0) {
+        handleEvent(event, &running);
+    }
+
+    if (running) {
+        writeOutput();
+    }
+    if (mode_ == ACQUIRE_POLL && running) {
+        readSensors();
+        SDL_Delay(POLL_INTERVAL);  // Delay to reduce CPU usage
+    }
+    return running;
+}
+
+void SdlBackend::writeOutput() {
+    DsOutputScheduler* output = sink_.output ? sink_.output->forController(controllerId_) : nullptr;
+    DsOutputState state;
+    uint32_t groups;
+    if (!output || !output->take(hostMonotonicUs(), &state, &groups)) {
+        return;
+    }
+    uint8_t common[DS_OUTPUT_COMMON_SIZE];
+    dsBuildOutputCommon(state, groups, common);
+    if (SDL_GameControllerSendEffect(controller_, common, sizeof(common)) < 0 && outputErrors_++ == 0) {
+        printf("Could not send controller output: %s\n", SDL_GetError());
+    }
+}
+
+void SdlBackend::handleEvent(const SDL_Event& event, bool* running) {
+    switch (event.type) {
+        case SDL_QUIT:
+            *running = false;
+            break;
+
+        case SDL_CONTROLLERBUTTONDOWN:
+        case SDL_CONTROLLERBUTTONUP:
+            sink_.emit(makeInputSample(SAMPLE_BUTTON, event.cbutton.which, event.cbutton.button,
+                                       event.cbutton.state == SDL_PRESSED), 0);
+            break;
+
+        case SDL_CONTROLLERAXISMOTION:
+            sink_.emit(makeInputSample(SAMPLE_AXIS, event.caxis.which, event.caxis.axis, event.caxis.value), 0);
+            break;
+
+        case SDL_CONTROLLERDEVICEREMOVED:
+            printf("Controller removed.\n");
+            *running = false;
+            break;
+
+        case SDL_CONTROLLERSENSORUPDATE:
+            // Every sensor report arrives as its own event; forward each one
+            if (mode_ == ACQUIRE_EVENTS) {
+                acquireSensorReading(event.csensor.which, event.csensor.sensor,
+                                     event.csensor.data, event.csensor.timestamp_us);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void SdlBackend::readSensors() {
+    // Check for accelerometer data
+    if (accelEnabled_) {
+        float accel[3] = {0};
+        Uint64 accelTimestampUs = 0;
+        if (SDL_GameControllerGetSensorDataWithTimestamp(controller_, SDL_SENSOR_ACCEL, &accelTimestampUs, accel, 3) == 0) {
+            acquireSensorReading(controllerId_, SDL_SENSOR_ACCEL, accel, accelTimestampUs);
+        } else if (!accelErrorLogged_) {
+            // Log the error only once
+            printf("Failed to read accelerometer data: %s\n", SDL_GetError());
+            lo_send(statusTarget_, "/ps5/sensor/error", "ss", "accelerometer", SDL_GetError());
+            accelErrorLogged_ = true;
+        }
+    }
+
+    // Check for gyroscope data
+    if (gyroEnabled_) {
+        float gyro[3] = {0};
+        Uint64 gyroTimestampUs = 0;
+        if (SDL_GameControllerGetSensorDataWithTimestamp(controller_, SDL_SENSOR_GYRO, &gyroTimestampUs, gyro, 3) == 0) {
+            acquireSensorReading(controllerId_, SDL_SENSOR_GYRO, gyro, gyroTimestampUs);
+        } else if (!gyroErrorLogged_) {
+            printf("Failed to read gyroscope data: %s\n", SDL_GetError());
+            lo_send(statusTarget_, "/ps5/sensor/error", "ss", "gyroscope", SDL_GetError());
+            gyroErrorLogged_ = true;
+        }
+    }
+}
+
+void SdlBackend::acquireSensorReading(SDL_JoystickID controller, int sensorType,
+                                      const float* data, Uint64 sensorTimestampUs) {
+    if (sensorType != SDL_SENSOR_GYRO && sensorType != SDL_SENSOR_ACCEL) {
+        return;
+    }
+    bool isGyro = sensorType == SDL_SENSOR_GYRO;
+    if (sensorTimestampUs != 0 && (isGyro || !gyroEnabled_)) {
+        loss_.addTimeOnly((uint32_t)sensorTimestampUs);
+    }
+
+    if (!pairImu_) {
+        sink_.emit(makeSensorSample(isGyro ? SAMPLE_GYRO : SAMPLE_ACCEL, controller, data,
+                                    sensorTimestampUs, clock_), 1);
+        return;
+    }
+
+    // A reading whose partner never arrives is overwritten by the next report and shows up as a drop
+    bool& pendingThis = isGyro ? pendingGyro_ : pendingAccel_;
+    if (pendingThis) {
+        sink_.counters->received++;
+    }
+    float* dst = isGyro ? &pending_.data[0] : &pending_.data[3];
+    dst[0] = data[0];
+    dst[1] = data[1];
+    dst[2] = data[2];
+    pendingThis = true;
+
+    if (pendingGyro_ && pendingAccel_) {
+        pending_.kind = SAMPLE_IMU;
+        pending_.controller = controller;
+        pending_.timestampUs = sensorTimestampUs;
+        pending_.hostTimeUs = clock_.map(sensorTimestampUs, hostMonotonicUs());
+        gyroBias_.process(pending_.data);
+        sink_.emit(pending_, 2);
+        if (gyroBias_.takeStillnessChange()) {
+            sink_.reportGyroBias(controller, gyroBias_);
+        }
+        pendingGyro_ = false;
+        pendingAccel_ = false;
+    }
+}
+
+void SdlBackend::checkStatus() {
+    // Check Bluetooth connection status
+    bool isConnected = SDL_GameControllerGetAttached(controller_);
+    if (isConnected != wasConnected_) {
+        const char* status = isConnected ? "connected" : "disconnected";
+        printf("Controller %s\n", status);
+        lo_send(statusTarget_, "/ps5/bluetooth/status", "s", status);
+        wasConnected_ = isConnected;
+    }
+
+    if (isConnected) {
+        // Check and reactivate sensors if needed
+        checkAndReactivateSensor(SDL_SENSOR_ACCEL, "accelerometer");
+        checkAndReactivateSensor(SDL_SENSOR_GYRO, "gyroscope");
+    }
+    sink_.reportLoss("SDL", controllerId_, loss_);
+    if (pairImu_) {
+        sink_.reportGyroBias(controllerId_, gyroBias_);
+    }
+}
+
+void SdlBackend::printStats() const {
+    const ReportLossStats& loss = loss_.totals();
+    printf("SDL: %llu sensor reports, %llu dropped (%.2f%%), %llu duplicated, %llu out of order\n",
+           (unsigned long long)loss.received, (unsigned long long)loss.dropped, loss.lossPercent(),
+           (unsigned long long)loss.duplicated, (unsigned long long)loss.outOfOrder);
+    if (outputErrors_ > 0) {
+        printf("SDL: %llu output effects failed\n", (unsigned long long)outputErrors_);
+    }
+}
+
+// Check and reactivate a sensor if needed
+bool SdlBackend::checkAndReactivateSensor(SDL_SensorType sensorType, const char* sensorName) {
+    if (!SDL_GameControllerHasSensor(controller_, sensorType)) {
+        lo_send(statusTarget_, "/ps5/sensor/status", "ss", sensorName, "not supported");
+        return false;
+    }
+
+    // Check if sensor is enabled
+    if (!SDL_GameControllerIsSensorEnabled(controller_, sensorType)) {
+        printf("Attempting to reactivate %s...\n", sensorName);
+        lo_send(statusTarget_, "/ps5/sensor/status", "ss", sensorName, "reactivating");
+
+        if (SDL_GameControllerSetSensorEnabled(controller_, sensorType, SDL_TRUE) < 0) {
+            printf("Failed to reactivate %s: %s\n", sensorName, SDL_GetError());
+            lo_send(statusTarget_, "/ps5/sensor/status", "ss", sensorName, "reactivation failed");
+            return false;
+        }
+
+        printf("%s reactivated successfully\n", sensorName);
+        lo_send(statusTarget_, "/ps5/sensor/status", "ss", sensorName, "active");
+        return true;
+    }
+
+    return true;
+}
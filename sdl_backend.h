@@ -0,0 +1,70 @@
+#ifndef SDL_BACKEND_H
+#define SDL_BACKEND_H
+
+#include <SDL.h>
+#include <lo/lo.h>
+#include "clock_sync.h"
+#include "host_clock.h"
+#include "input_backend.h"
+
+// How sensor data is acquired from SDL
+enum AcquisitionMode {
+    ACQUIRE_EVENTS, // forward every SDL_CONTROLLERSENSORUPDATE as it arrives
+    ACQUIRE_POLL    // legacy: sample the latest value every POLL_INTERVAL ms
+};
+
+// Input through SDL's game controller API: sensors, buttons and axes, with
+// connection and sensor status reported over OSC.
+//
+// SDL reports gyro and accel as separate events per controller report; when
+// both sensors are enabled they are paired back into a single SAMPLE_IMU record.
+// The gyro bias learned while the controller lies still is removed from it (see
+// GyroBiasEstimator) and stored per controller serial.
+//
+// Output settings go to SDL's PS5 driver as one effect block per wakeup,
+// which merges them into its own output report.
+class SdlBackend : public InputBackend {
+public:
+    SdlBackend(SampleSink& sink, AcquisitionMode mode, lo_address statusTarget);
+    ~SdlBackend() override;
+
+    const char* name() const override { return "sdl"; }
+    bool open() override;
+    bool pump(int timeoutMs) override;
+    void checkStatus() override;
+    void printStats() const override;
+    void close() override;
+    bool pairsImu() const override { return pairImu_; }
+
+private:
+    static const Uint32 POLL_INTERVAL = 100; // Sampling period of the legacy poll mode
+
+    void handleEvent(const SDL_Event& event, bool* running);
+    void readSensors();
+    void acquireSensorReading(SDL_JoystickID controller, int sensorType, const float* data, Uint64 sensorTimestampUs);
+    bool checkAndReactivateSensor(SDL_SensorType sensorType, const char* sensorName);
+    void writeOutput();
+
+    SampleSink& sink_;
+    AcquisitionMode mode_;
+    lo_address statusTarget_;
+    SDL_GameController* controller_ = NULL;
+    SDL_JoystickID controllerId_ = -1;
+    bool accelEnabled_ = false;
+    bool gyroEnabled_ = false;
+    bool wasConnected_ = true;
+    bool accelErrorLogged_ = false;
+    bool gyroErrorLogged_ = false;
+    uint64_t outputErrors_ = 0;
+
+    DeviceClockSync clock_;
+    ReportLossTracker loss_; // on the gyro timestamps, SDL does not pass the report counter on
+    bool pairImu_ = false;
+    Sample pending_ = {};
+    bool pendingGyro_ = false;
+    bool pendingAccel_ = false;
+    GyroBiasEstimator gyroBias_;
+    char serial_[64] = {0};
+};
+
+#endif // SDL_BACKEND_H
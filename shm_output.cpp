@@ -0,0 +1,80 @@
+#include "shm_output.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include "host_clock.h"
+
+static_assert(PS5_SHM_GYRO == (int)SAMPLE_GYRO && PS5_SHM_ACCEL == (int)SAMPLE_ACCEL &&
+              PS5_SHM_IMU == (int)SAMPLE_IMU && PS5_SHM_BUTTON == (int)SAMPLE_BUTTON &&
+              PS5_SHM_AXIS == (int)SAMPLE_AXIS && PS5_SHM_TOUCH == (int)SAMPLE_TOUCH,
+              "ps5_shm.h record kinds must match SampleKind");
+
+ShmOutput::~ShmOutput() {
+    if (shm_) {
+        munmap(shm_, size_);
+        shm_unlink(name_);
+    }
+}
+
+bool ShmOutput::open(const char* name, uint32_t capacity) {
+    uint32_t slots = 1;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+
+    snprintf(name_, sizeof(name_), "%s", name);
+    shm_unlink(name_); // drop a stale stream left by a crashed run
+    int fd = shm_open(name_, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        printf("Could not create shared memory %s: %s\n", name_, strerror(errno));
+        return false;
+    }
+
+    size_ = ps5_shm_size(slots);
+    if (ftruncate(fd, (off_t)size_) < 0) {
+        printf("Could not size shared memory %s: %s\n", name_, strerror(errno));
+        close(fd);
+        shm_unlink(name_);
+        return false;
+    }
+    void* p = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        printf("Could not map shared memory %s: %s\n", name_, strerror(errno));
+        shm_unlink(name_);
+        return false;
+    }
+
+    shm_ = (ps5_shm_header*)p;
+    records_ = ps5_shm_records(shm_);
+    shm_->version = PS5_SHM_VERSION;
+    shm_->capacity = slots;
+    shm_->record_size = sizeof(ps5_shm_record);
+    shm_->write_index = 0;
+    shm_->start_host_us = hostMonotonicUs();
+    // Readers check the magic last, so it marks the header as complete
+    __atomic_store_n(&shm_->magic, PS5_SHM_MAGIC, __ATOMIC_RELEASE);
+    return true;
+}
+
+void ShmOutput::publish(const Sample& sample) {
+    uint64_t index = shm_->write_index;
+    ps5_shm_record* slot = &records_[index & (shm_->capacity - 1)];
+
+    uint32_t seq = slot->seq;
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    slot->kind = (uint8_t)sample.kind;
+    slot->index = index;
+    slot->controller = sample.controller;
+    slot->code = sample.code;
+    slot->value = sample.value;
+    memcpy(slot->data, sample.data, sizeof(slot->data));
+    slot->timestamp_us = sample.timestampUs;
+    slot->host_time_us = sample.hostTimeUs;
+
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&shm_->write_index, index + 1, __ATOMIC_RELEASE);
+}
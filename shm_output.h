@@ -0,0 +1,35 @@
+#ifndef SHM_OUTPUT_H
+#define SHM_OUTPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ps5_shm.h"
+#include "sample.h"
+
+// Publishes samples into a POSIX shared-memory ring (layout in ps5_shm.h) so
+// processes on the same host can read the live stream without UDP or OSC.
+// publish() is a handful of stores and never blocks; it is called from the
+// acquisition thread, which is the only writer.
+class ShmOutput {
+public:
+    ShmOutput() = default;
+    ~ShmOutput();
+
+    ShmOutput(const ShmOutput&) = delete;
+    ShmOutput& operator=(const ShmOutput&) = delete;
+
+    // Create (or replace) the shared memory object; capacity is rounded up to a power of two
+    bool open(const char* name, uint32_t capacity);
+
+    void publish(const Sample& sample);
+
+    uint64_t published() const { return shm_ ? shm_->write_index : 0; }
+
+private:
+    char name_[64] = {0};
+    ps5_shm_header* shm_ = nullptr;
+    ps5_shm_record* records_ = nullptr;
+    size_t size_ = 0;
+};
+
+#endif // SHM_OUTPUT_H
@@ -0,0 +1,127 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+// Lock-free single-producer/single-consumer ring of fixed-size records.
+//
+// The producer never blocks: when the ring is full the record is discarded
+// and counted in overflows(), so a stalled consumer cannot delay acquisition.
+// The consumer may sleep in waitForData(); the producer only touches the
+// mutex when the consumer has announced that it is sleeping.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : mask_(roundUpPow2(capacity < 2 ? 2 : capacity) - 1),
+          slots_(new T[mask_ + 1]) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // Producer side
+    bool tryPush(const T& item) {
+        const uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - headCache_ > mask_) {
+            headCache_ = head_.load(std::memory_order_acquire);
+            if (tail - headCache_ > mask_) {
+                overflows_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        slots_[tail & mask_] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+
+        const uint64_t depth = tail + 1 - headCache_;
+        if (depth > highWater_.load(std::memory_order_relaxed)) {
+            highWater_.store(depth, std::memory_order_relaxed);
+        }
+
+        // Pairs with the fence in waitForData() so a wakeup is never lost
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (consumerWaiting_.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cond_.notify_one();
+        }
+        return true;
+    }
+
+    // Consumer side
+    bool tryPop(T& item) {
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head == tailCache_) {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (head == tailCache_) {
+                return false;
+            }
+        }
+        item = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Sleep until a record is available, wake() is called or the timeout expires
+    void waitForData(std::chrono::microseconds timeout) {
+        consumerWaiting_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait_for(lock, timeout, [this] { return !empty() || woken_; });
+        woken_ = false;
+        consumerWaiting_.store(false, std::memory_order_relaxed);
+    }
+
+    // Wake a sleeping consumer, e.g. on shutdown
+    void wake() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        woken_ = true;
+        cond_.notify_one();
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    size_t size() const {
+        return (size_t)(tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire));
+    }
+
+    uint64_t overflows() const { return overflows_.load(std::memory_order_relaxed); }
+    uint64_t highWater() const { return highWater_.load(std::memory_order_relaxed); }
+
+private:
+    static size_t roundUpPow2(size_t n) {
+        size_t p = 1;
+        while (p < n) {
+            p <<= 1;
+        }
+        return p;
+    }
+
+    const size_t mask_;
+    std::unique_ptr<T[]> slots_;
+
+    // Producer-owned line
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    uint64_t headCache_ = 0;
+    std::atomic<uint64_t> overflows_{0};
+    std::atomic<uint64_t> highWater_{0};
+
+    // Consumer-owned line
+    alignas(64) std::atomic<uint64_t> head_{0};
+    uint64_t tailCache_ = 0;
+    std::atomic<bool> consumerWaiting_{false};
+
+    alignas(64) std::mutex mutex_;
+    std::condition_variable cond_;
+    bool woken_ = false;
+};
+
+#endif // SPSC_RING_H
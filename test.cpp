@@ -1,24 +1,11 @@
 #include <hidapi/hidapi.h>
 #include <iostream>
-#include <iomanip>
 #include <chrono>
-#include <thread>
 #include <cstring>
+#include "dualsense.h"
+#include "dualsense_layout.h"
 
-// DualSense VID/PID
-#define DS_VENDOR_ID 0x054c
-#define DS_PRODUCT_ID 0x0ce6
-
-// DualSense input report offsets based on dualsensectl
-#define DS_INPUT_REPORT_USB 0x01
-#define DS_INPUT_REPORT_USB_SIZE 64
-#define DS_INPUT_REPORT_GYRO_X_OFFSET 16
-#define DS_INPUT_REPORT_GYRO_Y_OFFSET 18
-#define DS_INPUT_REPORT_GYRO_Z_OFFSET 20
-#define DS_INPUT_REPORT_ACCEL_X_OFFSET 22
-#define DS_INPUT_REPORT_ACCEL_Y_OFFSET 24
-#define DS_INPUT_REPORT_ACCEL_Z_OFFSET 26
-#define DS_INPUT_REPORT_SENSOR_TIMESTAMP_OFFSET 28
+// Raw report dump for checking offsets; ps5_kontroller --backend hid is the real reader
 
 int main(int argc, char* argv[]) {
     if (hid_init()) {
@@ -50,29 +37,46 @@ int main(int argc, char* argv[]) {
     // Main loop
     auto start_time = std::chrono::steady_clock::now();
     bool running = true;
-    uint8_t data[DS_INPUT_REPORT_USB_SIZE];
+    uint8_t reports[2][DS_INPUT_REPORT_BT_SIZE];
 
     while (running) {
-        // Read input report
-        int res = hid_read(device, data, sizeof(data));
-        if (res > 0) {
-            // Extract sensor data (assuming little-endian)
-            int16_t gyro_x = *(int16_t*)&data[DS_INPUT_REPORT_GYRO_X_OFFSET];
-            int16_t gyro_y = *(int16_t*)&data[DS_INPUT_REPORT_GYRO_Y_OFFSET];
-            int16_t gyro_z = *(int16_t*)&data[DS_INPUT_REPORT_GYRO_Z_OFFSET];
-            
-            int16_t accel_x = *(int16_t*)&data[DS_INPUT_REPORT_ACCEL_X_OFFSET];
-            int16_t accel_y = *(int16_t*)&data[DS_INPUT_REPORT_ACCEL_Y_OFFSET];
-            int16_t accel_z = *(int16_t*)&data[DS_INPUT_REPORT_ACCEL_Z_OFFSET];
-
-            uint32_t timestamp = *(uint32_t*)&data[DS_INPUT_REPORT_SENSOR_TIMESTAMP_OFFSET];
+        // Block for the next input report, then drain the queue and keep only the newest,
+        // so what is printed never falls behind the controller
+        int current = 0;
+        int res = hid_read_timeout(device, reports[current], DS_INPUT_REPORT_BT_SIZE, 100);
+        int length = res;
+        int backlog = 0;
+        while (res > 0) {
+            length = res;
+            backlog++;
+            res = hid_read_timeout(device, reports[current ^ 1], DS_INPUT_REPORT_BT_SIZE, 0);
+            if (res > 0) {
+                current ^= 1;
+            }
+        }
+        if (res < 0) {
+            std::cerr << "Read failed" << std::endl;
+            break;
+        }
 
-            // Print sensor data
-            std::cout << std::fixed << std::setprecision(2);
-            std::cout << "Gyro:  X=" << gyro_x << " Y=" << gyro_y << " Z=" << gyro_z << std::endl;
-            std::cout << "Accel: X=" << accel_x << " Y=" << accel_y << " Z=" << accel_z << std::endl;
-            std::cout << "Timestamp: " << timestamp << std::endl;
-            std::cout << "----------------------------------------" << std::endl;
+        // Print the newest report through the field table of its variant
+        if (backlog > 0) {
+            dsVisitReport(reports[current], length, [&](auto variant) {
+                constexpr const DsReportLayout& L = decltype(variant)::layout;
+                if constexpr (L.hasSensors()) {
+                    const uint8_t* data = reports[current];
+                    std::cout << "Report: " << L.name << std::endl;
+                    std::cout << "Gyro:  X=" << dsFieldValue<L, DS_FIELD_GYRO_X>(data)
+                              << " Y=" << dsFieldValue<L, DS_FIELD_GYRO_Y>(data)
+                              << " Z=" << dsFieldValue<L, DS_FIELD_GYRO_Z>(data) << std::endl;
+                    std::cout << "Accel: X=" << dsFieldValue<L, DS_FIELD_ACCEL_X>(data)
+                              << " Y=" << dsFieldValue<L, DS_FIELD_ACCEL_Y>(data)
+                              << " Z=" << dsFieldValue<L, DS_FIELD_ACCEL_Z>(data) << std::endl;
+                    std::cout << "Timestamp: " << dsFieldRaw<L, DS_FIELD_SENSOR_TIMESTAMP>(data)
+                              << " (newest of " << backlog << " queued reports)" << std::endl;
+                    std::cout << "----------------------------------------" << std::endl;
+                }
+            });
         }
 
         // Check if 10 seconds have passed
@@ -80,9 +84,6 @@ int main(int argc, char* argv[]) {
         if (std::chrono::duration_cast<std::chrono::seconds>(current_time - start_time).count() >= 10) {
             running = false;
         }
-
-        // Small delay to prevent too frequent polling
-        std::this_thread::sleep_for(std::chrono::milliseconds(16));  // ~60Hz
     }
 
     hid_close(device);
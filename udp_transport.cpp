@@ -0,0 +1,199 @@
+#include "udp_transport.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Large enough for a full batch of typical bundles, and for any single UDP datagram
+static const size_t SLAB_SIZE = 128 * 1024;
+
+UdpTransport::UdpTransport() : slab_(new uint8_t[SLAB_SIZE]) {
+    memset(destinations_, 0, sizeof(destinations_));
+}
+
+UdpTransport::~UdpTransport() {
+    if (fd4_ >= 0) {
+        close(fd4_);
+    }
+    if (fd6_ >= 0) {
+        close(fd6_);
+    }
+    delete[] slab_;
+}
+
+int UdpTransport::socketFor(int family) {
+    int& fd = family == AF_INET6 ? fd6_ : fd4_;
+    if (fd < 0) {
+        fd = socket(family, SOCK_DGRAM, 0);
+        if (fd < 0) {
+            printf("Could not create UDP socket: %s\n", strerror(errno));
+        }
+    }
+    return fd;
+}
+
+int UdpTransport::addDestination(const char* host, const char* port) {
+    if (destinationCount_ == MAX_DESTINATIONS) {
+        printf("Too many destinations (at most %d)\n", MAX_DESTINATIONS);
+        return -1;
+    }
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    addrinfo* result = NULL;
+    int err = getaddrinfo(host, port, &hints, &result);
+    if (err != 0) {
+        printf("Could not resolve %s:%s: %s\n", host, port, gai_strerror(err));
+        return -1;
+    }
+
+    int fd = socketFor(result->ai_family);
+    if (fd < 0) {
+        freeaddrinfo(result);
+        return -1;
+    }
+
+    Destination& dest = destinations_[destinationCount_];
+    memcpy(&dest.addr, result->ai_addr, result->ai_addrlen);
+    dest.addrLen = result->ai_addrlen;
+    dest.fd = fd;
+    snprintf(dest.name, sizeof(dest.name), "%s:%s", host, port);
+    freeaddrinfo(result);
+    return destinationCount_++;
+}
+
+bool UdpTransport::queue(const uint8_t* data, size_t length, uint32_t destinations) {
+    int sends = 0;
+    for (int i = 0; i < destinationCount_; ++i) {
+        sends += (destinations >> i) & 1;
+    }
+    if (sends == 0) {
+        return true;
+    }
+    if (length > SLAB_SIZE) {
+        sendErrors_ += sends;
+        return false;
+    }
+    if (queued_ + sends > MAX_BATCH || slabUsed_ + length > SLAB_SIZE) {
+        flush();
+    }
+
+    // One copy of the bytes, one entry per destination
+    memcpy(slab_ + slabUsed_, data, length);
+    for (int i = 0; i < destinationCount_; ++i) {
+        if ((destinations >> i) & 1) {
+            entries_[queued_].offset = slabUsed_;
+            entries_[queued_].length = length;
+            entries_[queued_].destination = i;
+            queued_++;
+        }
+    }
+    slabUsed_ += length;
+    return true;
+}
+
+void UdpTransport::countSend(int destination, bool ok) {
+    if (ok) {
+        destinations_[destination].sent++;
+        datagramsSent_++;
+    } else {
+        destinations_[destination].errors++;
+        sendErrors_++;
+    }
+}
+
+int UdpTransport::flush() {
+    if (queued_ == 0) {
+        return 0;
+    }
+
+    int bucket = 0;
+    while (bucket < HISTOGRAM_BUCKETS - 1 && queued_ > (1 << bucket)) {
+        bucket++;
+    }
+    histogram_[bucket]++;
+    flushes_++;
+
+    uint64_t sentBefore = datagramsSent_;
+#ifdef __linux__
+    struct iovec iov[MAX_BATCH];
+    struct mmsghdr msgs[MAX_BATCH];
+    int entryIndex[MAX_BATCH];
+
+    // sendmmsg takes a single socket, so batch per address family
+    const int fds[2] = {fd4_, fd6_};
+    for (int fd : fds) {
+        if (fd < 0) {
+            continue;
+        }
+
+        int count = 0;
+        for (int i = 0; i < queued_; ++i) {
+            Destination& dest = destinations_[entries_[i].destination];
+            if (dest.fd != fd) {
+                continue;
+            }
+            iov[count].iov_base = slab_ + entries_[i].offset;
+            iov[count].iov_len = entries_[i].length;
+            memset(&msgs[count], 0, sizeof(mmsghdr));
+            msgs[count].msg_hdr.msg_name = &dest.addr;
+            msgs[count].msg_hdr.msg_namelen = dest.addrLen;
+            msgs[count].msg_hdr.msg_iov = &iov[count];
+            msgs[count].msg_hdr.msg_iovlen = 1;
+            entryIndex[count] = i;
+            count++;
+        }
+
+        // sendmmsg may stop early; an error on the first remaining datagram drops just that one
+        int next = 0;
+        while (next < count) {
+            int n = sendmmsg(fd, msgs + next, count - next, 0);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                countSend(entries_[entryIndex[next]].destination, false);
+                next++;
+            } else {
+                for (int i = 0; i < n; ++i) {
+                    countSend(entries_[entryIndex[next + i]].destination, true);
+                }
+                next += n;
+            }
+        }
+    }
+#else
+    for (int i = 0; i < queued_; ++i) {
+        Destination& dest = destinations_[entries_[i].destination];
+        ssize_t sent = sendto(dest.fd, slab_ + entries_[i].offset, entries_[i].length, 0,
+                              (const sockaddr*)&dest.addr, dest.addrLen);
+        countSend(entries_[i].destination, sent >= 0);
+    }
+#endif
+
+    queued_ = 0;
+    slabUsed_ = 0;
+    return (int)(datagramsSent_ - sentBefore);
+}
+
+void UdpTransport::printStats() const {
+    static const char* LABELS[HISTOGRAM_BUCKETS] = {"1", "2", "3-4", "5-8", "9-16", "17-32", "33-64"};
+    printf("UDP: %llu datagrams in %llu flushes, %llu send errors; batch sizes:",
+           (unsigned long long)datagramsSent_, (unsigned long long)flushes_, (unsigned long long)sendErrors_);
+    for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        if (histogram_[i]) {
+            printf(" %s:%llu", LABELS[i], (unsigned long long)histogram_[i]);
+        }
+    }
+    printf("\n");
+    for (int i = 0; i < destinationCount_; ++i) {
+        printf("  %s: %llu datagrams, %llu errors\n", destinations_[i].name,
+               (unsigned long long)destinations_[i].sent, (unsigned long long)destinations_[i].errors);
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef UDP_TRANSPORT_H
+#define UDP_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+// Sends pre-encoded datagrams to a set of UDP destinations without liblo or the heap.
+//
+// A queued datagram is copied once into a slab allocated at construction and
+// then sent to every destination in its mask, all sends pointing at the same
+// bytes. flush() sends everything queued; on Linux that is one sendmmsg call
+// per address family, elsewhere one sendto per datagram and destination.
+// queue() flushes by itself when the slab is full. Batch sizes are recorded in
+// a power-of-two histogram.
+class UdpTransport {
+public:
+    static const int MAX_DESTINATIONS = 8;
+    static const int MAX_BATCH = 64;        // sends per flush
+    static const int HISTOGRAM_BUCKETS = 7; // 1, 2, 3-4, 5-8, 9-16, 17-32, 33-64
+
+    UdpTransport();
+    ~UdpTransport();
+
+    UdpTransport(const UdpTransport&) = delete;
+    UdpTransport& operator=(const UdpTransport&) = delete;
+
+    // Resolve host:port; returns the destination index or -1
+    int addDestination(const char* host, const char* port);
+    int destinationCount() const { return destinationCount_; }
+
+    // Copy a datagram into the queue for every destination in the bit mask
+    bool queue(const uint8_t* data, size_t length, uint32_t destinations);
+
+    // Send everything queued; returns the number of datagrams sent
+    int flush();
+
+    bool pending() const { return queued_ > 0; }
+
+    uint64_t datagramsSent() const { return datagramsSent_; }
+    uint64_t sendErrors() const { return sendErrors_; }
+    uint64_t flushes() const { return flushes_; }
+    const uint64_t* batchSizeHistogram() const { return histogram_; }
+
+    void printStats() const;
+
+private:
+    struct Destination {
+        sockaddr_storage addr;
+        socklen_t addrLen;
+        int fd;
+        char name[80];
+        uint64_t sent;
+        uint64_t errors;
+    };
+
+    struct Entry {
+        size_t offset;
+        size_t length;
+        int destination;
+    };
+
+    int socketFor(int family);
+    void countSend(int destination, bool ok);
+
+    int fd4_ = -1;
+    int fd6_ = -1;
+    Destination destinations_[MAX_DESTINATIONS];
+    int destinationCount_ = 0;
+
+    uint8_t* slab_;
+    size_t slabUsed_ = 0;
+    Entry entries_[MAX_BATCH];
+    int queued_ = 0;
+
+    uint64_t datagramsSent_ = 0;
+    uint64_t sendErrors_ = 0;
+    uint64_t flushes_ = 0;
+    uint64_t histogram_[HISTOGRAM_BUCKETS] = {};
+};
+
+#endif // UDP_TRANSPORT_H
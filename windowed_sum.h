@@ -0,0 +1,76 @@
+#ifndef WINDOWED_SUM_H
+#define WINDOWED_SUM_H
+
+#include <stdint.h>
+#include <string.h>
+
+// The last entries (at most CAPACITY) of N float channels in a ring buffer,
+// with a running sum per channel, so a windowed mean or energy costs an add
+// and a subtract per entry. Every time the ring wraps the sums are recomputed
+// from the entries, so rounding in the running sums never accumulates.
+//
+// A full ring drops its oldest entry on push; time windows drop from the
+// oldest end themselves, using the time stored with each entry.
+//
+// No constructor: zero-filled memory is an empty window, so owners may clear
+// it with memset, otherwise call clear().
+template <int N, int CAPACITY>
+class WindowedSum {
+public:
+    void clear() {
+        next_ = 0;
+        count_ = 0;
+        memset(sums_, 0, sizeof(sums_));
+    }
+
+    int count() const { return count_; }
+    bool full() const { return count_ == CAPACITY; }
+    double sum(int channel) const { return sums_[channel]; }
+
+    uint64_t oldestTimeUs() const { return timesUs_[oldestSlot()]; }
+
+    void dropOldest() {
+        const float* oldest = values_[oldestSlot()];
+        for (int i = 0; i < N; ++i) {
+            sums_[i] -= oldest[i];
+        }
+        count_--;
+    }
+
+    void push(const float* values, uint64_t timeUs = 0) {
+        if (count_ == CAPACITY) {
+            dropOldest();
+        }
+        memcpy(values_[next_], values, sizeof(values_[next_]));
+        timesUs_[next_] = timeUs;
+        for (int i = 0; i < N; ++i) {
+            sums_[i] += values[i];
+        }
+        count_++;
+        if (++next_ == CAPACITY) {
+            next_ = 0;
+            resum();
+        }
+    }
+
+private:
+    int oldestSlot() const { return (next_ - count_ + CAPACITY) % CAPACITY; }
+
+    void resum() {
+        memset(sums_, 0, sizeof(sums_));
+        for (int age = count_; age > 0; --age) {
+            const float* entry = values_[(next_ - age + CAPACITY) % CAPACITY];
+            for (int i = 0; i < N; ++i) {
+                sums_[i] += entry[i];
+            }
+        }
+    }
+
+    int next_;  // slot for the next entry
+    int count_; // entries in the window
+    double sums_[N];
+    float values_[CAPACITY][N];
+    uint64_t timesUs_[CAPACITY];
+};
+
+#endif // WINDOWED_SUM_H